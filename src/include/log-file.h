@@ -85,6 +85,30 @@ struct struct_logbuf {
 typedef struct struct_logbuf LogBuffer_t;
 #endif
 
+/* A log file ends with an index of its event blocks, which lets a viewer seek to a
+ * time window and decode only the blocks that overlap it.  The index is an array of
+ * LogIndexEntry_t structs, sorted by vproc and then by time, followed by a
+ * LogIndexFooter_t, which occupies the last bytes of the file.  Timestamps are in
+ * nanoseconds on the log's clock.  Both structs are written in the native byte order.
+ * A file whose last eight bytes are not LOG_INDEX_MAGIC does not have an index.
+ */
+#define LOG_INDEX_MAGIC	0x6D616E7469646578ll	// "mantidex"
+
+typedef struct {
+    uint64_t		offset;		// file offset of the block
+    uint64_t		firstTS;	// timestamp of the first event in the block
+    uint64_t		lastTS;		// timestamp of the last event in the block
+    uint32_t		szB;		// size of the block in bytes
+    uint32_t		vpId;		// ID of vproc that owns the block
+} LogIndexEntry_t;
+
+typedef struct {
+    uint64_t		indexOffset;	// file offset of the first index entry
+    uint32_t		nEntries;	// number of index entries
+    uint32_t		nVProcs;	// number of vprocs in system
+    uint64_t		magic;		// LOG_INDEX_MAGIC
+} LogIndexFooter_t;
+
 /* define the predefined log-event codes */
 #include "log-events.h"
 
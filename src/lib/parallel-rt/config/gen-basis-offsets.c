@@ -13,6 +13,7 @@
 #include "manticore-rt.h"
 #include <stdio.h>
 #include "vproc.h"
+#include "heap.h"
 #include "log-file.h"
 #include "crc.h"
 
@@ -74,6 +75,10 @@ int main ()
     PR_OFFSET(logEvent, LOG_EVENT_KIND_OFFSET, event);
     PR_OFFSET(logEvent, LOG_EVENT_DATA_OFFSET, data);
 
+  /* a fresh chunk holds an unused first word, the array's header, and the array */
+    printf ("\n/* the longest polymorphic array that AllocBigPolyArray can allocate */\n");
+    PR_DEFINE(MAX_GLOBAL_ARRAY_LEN, HEAP_CHUNK_SZB / WORD_SZB - 3);
+
     printf ("\n/* magic number */\n");
     printf ("#define MAGIC %#0x\n", CRC32(buf, bp - (char *)buf));
 
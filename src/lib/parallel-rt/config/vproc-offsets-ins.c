@@ -37,6 +37,7 @@
     VP_OFFSET(vp, STD_CONT, stdCont, true);
     VP_OFFSET(vp, STD_EXH, stdExnCont, true);
     VP_OFFSET(vp, ALLOC_PTR, allocPtr, true);
+    VP_OFFSET(vp, ALLOC_SITE_CNTS, allocSiteCnts, true);
     VP_OFFSET(vp, EVENT_ID, eventId, true);
     VP_OFFSET(vp, LOG, log, true);
     VP_OFFSET(vp, EVENT_LOG, event_log, true);
@@ -23,6 +23,12 @@
 #include "os-threads.h"
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined (TARGET_LINUX)
+#  include <sched.h>
+#  include <dirent.h>
+#endif
 
 
 /* globals */
@@ -32,31 +38,72 @@ int		NumHWThreads;	//!< \brief number of hardware threads
 int		NumCoresPerNode; //!< \brief number of cores per thread
 int		NumThdsPerCore; //!< \brief number of threads per core
 Location_t	*Locations;	//!< \brief an array of the availble locations
+Location_t	*SpreadLocations; //!< \brief the locations ordered to spread out the load
+int		NumUsableCPUs;	//!< \brief number of CPUs that we are allowed to use
+
+static int	*LocCPUs;	// the OS processor ID of each entry in Locations
+static int	*NodeIds;	// the OS NUMA node ID of each node
 
 /* local functions */
 static bool GetNumCPUs ();
+#if defined (TARGET_LINUX)
+static bool GetSysFSTopology ();
+static double GetCPUQuota ();
+#endif
+static int CompareSpread (const void *a, const void *b);
 
 
 /*! \brief initialization function that determines the hardware topology.
  */
 void DiscoverTopology ()
 {
-    if (! GetNumCPUs()) {
-	Die ("unable to determine hardware topology");
-    }
+#if defined (TARGET_LINUX)
+  /* on Linux, we prefer the topology from sysfs, which is restricted to the
+   * processors in our affinity mask (e.g., the cpuset of a container).
+   */
+    if (! GetSysFSTopology())
+#endif
+    {
+	if (! GetNumCPUs()) {
+	    Die ("unable to determine hardware topology");
+	}
 
-    Locations = NEWVEC(Location_t, NumHWThreads);
-    if (Locations == 0) {
-	Die("unable to allocation locations array");
-    }
-    for (int nd = 0, i = 0;  nd < NumHWNodes;  nd++) {
-	for (int core = 0;  core < NumCoresPerNode;  core++) {
-	    for (int thd = 0;  thd < NumThdsPerCore;  thd++) {
-		Locations[i++] = Location(nd, core, thd);
+	Locations = NEWVEC(Location_t, NumHWThreads);
+	LocCPUs = NEWVEC(int, NumHWThreads);
+	NodeIds = NEWVEC(int, NumHWNodes);
+	if ((Locations == 0) || (LocCPUs == 0) || (NodeIds == 0)) {
+	    Die("unable to allocation locations array");
+	}
+	for (int nd = 0, i = 0;  nd < NumHWNodes;  nd++) {
+	    NodeIds[nd] = nd;
+	    for (int core = 0;  core < NumCoresPerNode;  core++) {
+		for (int thd = 0;  thd < NumThdsPerCore;  thd++) {
+		    Locations[i] = Location(nd, core, thd);
+		    LocCPUs[i] = LogicalId(Locations[i]);
+		    i++;
+		}
 	    }
 	}
     }
 
+  /* the spread order visits the nodes round-robin, then the cores of the nodes,
+   * and then the hardware threads of the cores.
+   */
+    SpreadLocations = NEWVEC(Location_t, NumHWThreads);
+    memcpy (SpreadLocations, Locations, NumHWThreads * sizeof(Location_t));
+    qsort (SpreadLocations, NumHWThreads, sizeof(Location_t), CompareSpread);
+
+  /* limit the number of usable CPUs by the CPU quota of our cgroup (if any) */
+    NumUsableCPUs = NumHWThreads;
+#if defined (TARGET_LINUX)
+    double quota = GetCPUQuota();
+    if (quota > 0.0) {
+	int n = (int)quota;
+	if ((double)n < quota) n++;
+	if (n < NumUsableCPUs) NumUsableCPUs = n;
+    }
+#endif
+
 #ifdef HAVE_LIBNUMA
     if (numa_available() == -1) {
         Die ("NUMA is not available on this machine");
@@ -68,8 +115,8 @@ void DiscoverTopology ()
 #endif
 
 #ifndef NDEBUG
-    SayDebug ("%d nodes, %d cores, and %d threads\n",
-	NumHWNodes, NumHWCores, NumHWThreads);
+    SayDebug ("%d nodes, %d cores, and %d threads (%d usable)\n",
+	NumHWNodes, NumHWCores, NumHWThreads, NumUsableCPUs);
 #endif
 
 }
@@ -88,16 +135,16 @@ static void *InitWithLocation (void *arg)
     ThreadInitFn_t f = locArg->init;
 
 #ifdef HAVE_LIBNUMA
-    int node = LocationNode(locArg->loc);
+    int node = NodeIds[LocationNode(locArg->loc)];
     if (numa_run_on_node (node) == -1) {
-        Warning("unable to set affinity to virtual processor %d, node %d\n", LogicalId(locArg->loc), node);
+        Warning("unable to set affinity to virtual processor %d, node %d\n", LocationCPU(locArg->loc), node);
     }
 #elif HAVE_SCHED_SETAFFINITY
     cpu_set_t	cpus;
     CPU_ZERO(&cpus);
-    CPU_SET(LogicalId(locArg->loc), &cpus);
+    CPU_SET(LocationCPU(locArg->loc), &cpus);
     if (sched_setaffinity (0, sizeof(cpu_set_t), &cpus) == -1) {
-	Warning("unable to set affinity to processor %d\n", LogicalId(locArg->loc));
+	Warning("unable to set affinity to processor %d\n", LocationCPU(locArg->loc));
     }
 #endif
 
@@ -119,6 +166,17 @@ bool SpawnAt (OSThread_t *tidOut, ThreadInitFn_t f, void *arg, Location_t loc)
 
 }
 
+/*! \brief return the OS processor ID of a location */
+int LocationCPU (Location_t loc)
+{
+    for (int i = 0;  i < NumHWThreads;  i++) {
+	if (Locations[i] == loc)
+	    return LocCPUs[i];
+    }
+    return LogicalId(loc);
+
+}
+
 /*! \brief determine the number of CPUs */
 static bool GetNumCPUs ()
 {
@@ -214,6 +272,288 @@ static bool GetNumCPUs ()
 
 } /* end of GetNumCPUs */
 
+#if defined (TARGET_LINUX)
+
+typedef struct {
+    int		cpu;		// OS processor ID
+    int		node;		// OS NUMA node ID (or package ID when there is no NUMA info)
+    int		pkg;		// physical package ID
+    int		core;		// core ID (unique within the package)
+} CPUInfo_t;
+
+/* read an integer from a sysfs file; returns -1 on failure */
+static int ReadIntFile (const char *path)
+{
+    FILE *f = fopen(path, "r");
+    int n;
+
+    if (f == NULL)
+	return -1;
+    if (fscanf(f, "%d", &n) != 1)
+	n = -1;
+    fclose (f);
+    return n;
+
+}
+
+/* return the NUMA node of a processor, which is given by the "nodeN" link in its
+ * sysfs directory; returns -1 if the kernel does not report a node.
+ */
+static int GetCPUNode (int cpu)
+{
+    char path[128];
+    snprintf (path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR *dir = opendir(path);
+    int node = -1;
+
+    if (dir == NULL)
+	return -1;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+	if ((strncmp(ent->d_name, "node", 4) == 0) && (sscanf(ent->d_name + 4, "%d", &node) == 1))
+	    break;
+	node = -1;
+    }
+    closedir (dir);
+    return node;
+
+}
+
+static int CompareCPUInfo (const void *a, const void *b)
+{
+    const CPUInfo_t *p = (const CPUInfo_t *)a;
+    const CPUInfo_t *q = (const CPUInfo_t *)b;
+
+    if (p->node != q->node) return p->node - q->node;
+    if (p->pkg != q->pkg) return p->pkg - q->pkg;
+    if (p->core != q->core) return p->core - q->core;
+    return p->cpu - q->cpu;
+
+}
+
+/*! \brief determine the topology of the processors in our affinity mask from
+ *  the /sys/devices/system/cpu/cpuN/topology directories.  The nodes, cores, and
+ *  threads that we find are numbered densely, so a cpuset that only covers part
+ *  of the machine looks like a smaller machine.
+ *  \return false if the information is not available.
+ */
+static bool GetSysFSTopology ()
+{
+    cpu_set_t	allowed;
+    char	path[128];
+
+#if defined(HAVE_SCHED_GETAFFINITY)
+    if (sched_getaffinity (0, sizeof(allowed), &allowed) == -1)
+	return false;
+#else
+    CPU_ZERO(&allowed);
+    for (int cpu = 0;  cpu < CPU_SETSIZE;  cpu++)
+	CPU_SET(cpu, &allowed);
+#endif
+
+    CPUInfo_t *info = NEWVEC(CPUInfo_t, CPU_SETSIZE);
+    int n = 0;
+    bool haveNUMA = false;
+    for (int cpu = 0;  cpu < CPU_SETSIZE;  cpu++) {
+	if (! CPU_ISSET(cpu, &allowed))
+	    continue;
+	snprintf (path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+	int pkg = ReadIntFile (path);
+	snprintf (path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/core_id", cpu);
+	int core = ReadIntFile (path);
+	if ((pkg < 0) || (core < 0))
+	    continue;  /* offline or non-existent processor */
+	int node = GetCPUNode (cpu);
+	haveNUMA |= (node >= 0);
+	info[n].cpu = cpu;
+	info[n].node = node;
+	info[n].pkg = pkg;
+	info[n].core = core;
+	n++;
+    }
+    if (n == 0) {
+	FREE (info);
+	return false;
+    }
+    if (! haveNUMA) {
+      /* without NUMA information, the packages are the nodes */
+	for (int i = 0;  i < n;  i++)
+	    info[i].node = info[i].pkg;
+    }
+    qsort (info, n, sizeof(CPUInfo_t), CompareCPUInfo);
+
+  /* renumber the nodes, cores, and threads */
+    Locations = NEWVEC(Location_t, n);
+    LocCPUs = NEWVEC(int, n);
+    NodeIds = NEWVEC(int, n);
+    int nd = -1, core = 0, thd = 0;
+    NumHWCores = 0;
+    NumCoresPerNode = 0;
+    NumThdsPerCore = 0;
+    for (int i = 0;  i < n;  i++) {
+	if ((i == 0) || (info[i].node != info[i-1].node)) {
+	    nd++;
+	    NodeIds[nd] = haveNUMA ? info[i].node : 0;
+	    core = 0;
+	    thd = 0;
+	    NumHWCores++;
+	}
+	else if ((info[i].pkg != info[i-1].pkg) || (info[i].core != info[i-1].core)) {
+	    core++;
+	    thd = 0;
+	    NumHWCores++;
+	}
+	else
+	    thd++;
+	if ((nd >= (1 << LOC_NODE_BITS)) || (core >= (1 << LOC_CORE_BITS)) || (thd >= (1 << LOC_THREAD_BITS))) {
+	    Warning ("processor %d is outside the supported topology\n", info[i].cpu);
+	    FREE (info);
+	    FREE (Locations);
+	    FREE (LocCPUs);
+	    FREE (NodeIds);
+	    return false;
+	}
+	if (core + 1 > NumCoresPerNode) NumCoresPerNode = core + 1;
+	if (thd + 1 > NumThdsPerCore) NumThdsPerCore = thd + 1;
+	Locations[i] = Location(nd, core, thd);
+	LocCPUs[i] = info[i].cpu;
+    }
+    NumHWNodes = nd + 1;
+    NumHWThreads = n;
+
+    FREE (info);
+    return true;
+
+}
+
+/* read the CPU quota (as a number of CPUs) from a cgroup directory; returns 0.0 if
+ * there is no quota.
+ */
+static double ReadCPUQuota (const char *dir, bool isV2)
+{
+    char path[1024];
+    long quota, period;
+
+    if (isV2) {
+      /* cpu.max contains "max <period>" or "<quota> <period>" */
+	snprintf (path, sizeof(path), "%s/cpu.max", dir);
+	FILE *f = fopen(path, "r");
+	if (f == NULL)
+	    return 0.0;
+	int nItems = fscanf(f, "%ld %ld", &quota, &period);
+	fclose (f);
+	if (nItems != 2)
+	    return 0.0;
+    }
+    else {
+	snprintf (path, sizeof(path), "%s/cpu.cfs_quota_us", dir);
+	quota = ReadIntFile (path);
+	snprintf (path, sizeof(path), "%s/cpu.cfs_period_us", dir);
+	period = ReadIntFile (path);
+    }
+
+    if ((quota <= 0) || (period <= 0))
+	return 0.0;
+    else
+	return (double)quota / (double)period;
+
+}
+
+/* return the smallest CPU quota of the cgroup cgPath and its ancestors under the
+ * mount point mnt.  When we are in a cgroup namespace, the path may not exist under
+ * the mount point, in which case we end up at the root of the mount.
+ */
+static double CgroupQuota (const char *mnt, const char *cgPath, bool isV2)
+{
+    char dir[1024];
+    double minQuota = 0.0;
+
+    int len = snprintf (dir, sizeof(dir), "%s%s", mnt, cgPath);
+    if (len >= (int)sizeof(dir))
+	return 0.0;
+    int mntLen = strlen(mnt);
+    while (true) {
+	double q = ReadCPUQuota (dir, isV2);
+	if ((q > 0.0) && ((minQuota == 0.0) || (q < minQuota)))
+	    minQuota = q;
+	char *slash = strrchr(dir + mntLen, '/');
+	if (slash == NULL)
+	    break;
+	*slash = '\0';
+    }
+
+    return minQuota;
+
+}
+
+/*! \brief return the CPU quota of our cgroup (cgroup v2 cpu.max or cgroup v1
+ *  cpu.cfs_quota_us) as a number of CPUs; 0.0 means that there is no quota.
+ */
+static double GetCPUQuota ()
+{
+    FILE *f = fopen("/proc/self/cgroup", "r");
+    char buf[1024];
+    double quota = 0.0;
+
+    if (f == NULL)
+	return 0.0;
+
+  /* each line has the form "<id>:<controllers>:<path>"; the controllers are
+   * empty for cgroup v2.
+   */
+    while ((quota == 0.0) && (fgets(buf, sizeof(buf), f) != 0)) {
+	buf[strcspn(buf, "\n")] = '\0';
+	char *ctls = strchr(buf, ':');
+	if (ctls == NULL) continue;
+	ctls++;
+	char *cgPath = strchr(ctls, ':');
+	if (cgPath == NULL) continue;
+	*cgPath++ = '\0';
+	if (*ctls == '\0') {
+	    quota = CgroupQuota ("/sys/fs/cgroup", cgPath, true);
+	}
+	else {
+	  /* look for the "cpu" controller in the comma-separated list */
+	    bool hasCPU = false;
+	    char ctlsCopy[256];
+	    strncpy (ctlsCopy, ctls, sizeof(ctlsCopy)-1);
+	    ctlsCopy[sizeof(ctlsCopy)-1] = '\0';
+	    for (char *tok = strtok(ctlsCopy, ",");  tok != NULL;  tok = strtok(NULL, ",")) {
+		if (strcmp(tok, "cpu") == 0) hasCPU = true;
+	    }
+	    if (hasCPU) {
+		char mnt[512];
+		snprintf (mnt, sizeof(mnt), "/sys/fs/cgroup/%s", ctls);
+		quota = CgroupQuota (mnt, cgPath, false);
+		if (quota == 0.0)
+		    quota = CgroupQuota ("/sys/fs/cgroup/cpu", cgPath, false);
+	    }
+	}
+    }
+    fclose (f);
+
+    return quota;
+
+}
+
+#endif /* TARGET_LINUX */
+
+/* order locations by thread, then core, and then node */
+static int CompareSpread (const void *a, const void *b)
+{
+    Location_t p = *(const Location_t *)a;
+    Location_t q = *(const Location_t *)b;
+    int thdMask = (1 << LOC_THREAD_BITS) - 1;
+    int coreMask = (1 << LOC_CORE_BITS) - 1;
+
+    if ((p & thdMask) != (q & thdMask))
+	return (int)(p & thdMask) - (int)(q & thdMask);
+    if (((p >> LOC_THREAD_BITS) & coreMask) != ((q >> LOC_THREAD_BITS) & coreMask))
+	return (int)((p >> LOC_THREAD_BITS) & coreMask) - (int)((q >> LOC_THREAD_BITS) & coreMask);
+    return LocationNode(p) - LocationNode(q);
+
+}
+
 /*! \brief put a string representation of the location in the buffer.
  *  \param buf the string buffer
  *  \param bufSz the size of the buffer.
@@ -0,0 +1,137 @@
+/* alloc-prof.c
+ *
+ * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
+ * All rights reserved.
+ *
+ * Allocation-site profiling.  The profile is written when the program exits;
+ * it lists the sites in order of decreasing bytes allocated:
+ *
+ *	site <id> <objects> <bytes> <survived objects> <survived bytes> <desc>
+ *
+ * The survivor counts are the objects and bytes of the site that were copied
+ * by minor GCs.  Raw and vector objects share their header IDs, so their
+ * survivors cannot be attributed to a site and are reported as "-".
+ */
+
+#include "manticore-rt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "vproc.h"
+#include "options.h"
+#include "gc-inline.h"
+#include "alloc-prof.h"
+
+#define FIRST_SITE_ID	3	/* IDs below this are shared by raw, vector, and proxy objects */
+
+typedef struct {
+    int		id;
+    uint64_t	nObjs, nBytes;		// allocation counts
+    uint64_t	nSurvObjs, nSurvBytes;	// minor-GC survivor counts
+} SiteRow_t;
+
+/* the table of allocation sites; generated by the compiler */
+extern AllocSite_t	mantAllocSiteTbl[];
+
+bool			AllocProfFlg = false;
+static const char	*AllocProfFile;
+static int		NumAllocSites;
+static uint64_t		*SurvCounts[MAX_NUM_VPROCS];	// per-vproc (objects, bytes) pairs
+							// indexed by header ID
+
+static int CompareRows (const void *a, const void *b);
+
+void InitAllocProf (Options_t *opts)
+{
+    AllocProfFile = GetStringEqOpt (opts, "-allocprof", DFLT_ALLOC_PROF_FILE);
+    if (AllocProfFile == 0)
+	AllocProfFile = DFLT_ALLOC_PROF_FILE;
+
+    for (NumAllocSites = 0;  mantAllocSiteTbl[NumAllocSites].desc != 0;  NumAllocSites++)
+	continue;
+
+    AllocProfFlg = (NumAllocSites > 0);
+
+}
+
+void AllocProfStartVProc (VProc_t *vp)
+{
+    if (! AllocProfFlg) {
+	vp->allocSiteCnts = 0;
+	return;
+    }
+
+    vp->allocSiteCnts = NEWVEC(uint64_t, 2*NumAllocSites);
+    memset (vp->allocSiteCnts, 0, 2*NumAllocSites*sizeof(uint64_t));
+
+    SurvCounts[vp->id] = NEWVEC(uint64_t, 2*tableLen);
+    memset (SurvCounts[vp->id], 0, 2*tableLen*sizeof(uint64_t));
+
+}
+
+void AllocProfSurvivor (VProc_t *vp, Word_t hdr)
+{
+    uint64_t *cnt = SurvCounts[vp->id] + 2*getID(hdr);
+    cnt[0]++;
+    cnt[1] += WORD_SZB * (GetLength(hdr) + 1);
+}
+
+void WriteAllocProf ()
+{
+    if (! AllocProfFlg)
+	return;
+
+    FILE *f = fopen(AllocProfFile, "w");
+    if (f == NULL) {
+	Warning ("unable to open allocation profile \"%s\"\n", AllocProfFile);
+	return;
+    }
+
+    SiteRow_t *rows = NEWVEC(SiteRow_t, NumAllocSites);
+    for (int s = 0;  s < NumAllocSites;  s++) {
+	int hdrId = mantAllocSiteTbl[s].hdrId;
+	rows[s].id = s;
+	rows[s].nObjs = rows[s].nBytes = 0;
+	rows[s].nSurvObjs = rows[s].nSurvBytes = 0;
+	for (int i = 0;  i < NumVProcs;  i++) {
+	    rows[s].nObjs += VProcs[i]->allocSiteCnts[2*s];
+	    rows[s].nBytes += VProcs[i]->allocSiteCnts[2*s+1];
+	    if (hdrId >= FIRST_SITE_ID) {
+		rows[s].nSurvObjs += SurvCounts[i][2*hdrId];
+		rows[s].nSurvBytes += SurvCounts[i][2*hdrId+1];
+	    }
+	}
+    }
+
+    qsort (rows, NumAllocSites, sizeof(SiteRow_t), CompareRows);
+
+    for (int i = 0;  i < NumAllocSites;  i++) {
+	SiteRow_t *row = &(rows[i]);
+	if (row->nObjs == 0)
+	    break;
+	if (mantAllocSiteTbl[row->id].hdrId >= FIRST_SITE_ID)
+	    fprintf (f, "site %d %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %s\n",
+		row->id, row->nObjs, row->nBytes, row->nSurvObjs, row->nSurvBytes,
+		mantAllocSiteTbl[row->id].desc);
+	else
+	    fprintf (f, "site %d %" PRIu64 " %" PRIu64 " - - %s\n",
+		row->id, row->nObjs, row->nBytes, mantAllocSiteTbl[row->id].desc);
+    }
+
+    fclose (f);
+    FREE (rows);
+
+}
+
+/* order rows by decreasing bytes allocated */
+static int CompareRows (const void *a, const void *b)
+{
+    const SiteRow_t *ra = (const SiteRow_t *)a;
+    const SiteRow_t *rb = (const SiteRow_t *)b;
+
+    if (ra->nBytes > rb->nBytes) return -1;
+    else if (ra->nBytes < rb->nBytes) return 1;
+    else return (ra->id - rb->id);
+
+}
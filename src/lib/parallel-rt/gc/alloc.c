@@ -162,21 +162,25 @@ Value_t GlobalAllocRawArray (VProc_t *vp, int nElems, int szBOfElt)
     int nArrayBytes = nElems * szBOfElt; 
                       /* number of bytes consumed by the array */
 
-    int nObjBytes = WORD_SZB + nArrayBytes;
+    int nWords = BYTES_TO_WORDS(nArrayBytes);
+                      /* the array rounded up to whole words, so that globNextW
+                       * stays word aligned */
+
+    int nObjBytes = WORD_SZB * (nWords + 1);
                       /* number of bytes consumed by the array heap object */
 
     Word_t *obj;
     assert(nElems >= 0);
     assert(nArrayBytes < HEAP_CHUNK_SZB); /* the array has to fit inside a heap chunk */
 
-    EnsureGlobalSpace (vp, nElems);
+    EnsureGlobalSpace (vp, nWords);
             
     obj = (Word_t*)(vp->globNextW);
-    obj[-1] = RAW_HDR(BYTES_TO_WORDS(nArrayBytes));
+    obj[-1] = RAW_HDR(nWords);
     vp->globNextW += nObjBytes;
 
 #ifndef NO_GC_STATS
-    vp->globalStats.nBytesAlloc += WORD_SZB + nArrayBytes;
+    vp->globalStats.nBytesAlloc += nObjBytes;
 #endif
 
     return PtrToValue(obj);
@@ -311,12 +315,16 @@ Value_t GlobalAllocUniform (VProc_t *vp, int nElems, ...)
  */
 Value_t GlobalAllocNonUniform (VProc_t *vp, int nElems, ...)
 {
-    Word_t *obj = (Word_t *)(vp->globNextW);
     va_list ap;
     int bits = 0;
 
     EnsureGlobalSpace (vp, nElems);
 
+  /* EnsureGlobalSpace may switch to a new chunk, so we must not read globNextW
+   * before calling it.
+   */
+    Word_t *obj = (Word_t *)(vp->globNextW);
+
     va_start(ap, nElems);
     for (int i = 0;  i < nElems;  i++) {
         int tag = va_arg(ap, int);
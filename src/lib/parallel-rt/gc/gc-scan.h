@@ -14,6 +14,10 @@ typedef struct{
 //table array to match the tagbits with the entries
 extern tableentry table[];
 
+//the number of header IDs and the descriptions of their object types
+extern int tableLen;
+extern const char *tableDesc[];
+
 #ifndef NDEBUG
 
 extern void CheckLocalPtrMinor (VProc_t *, void *, const char *);
@@ -13,6 +13,7 @@
 #include "gc.h"
 #include "vproc.h"
 #include "os-threads.h"
+#include "spin-barrier.h"
 #include "os-memory.h"
 #include "internal-heap.h"
 #include "gc-inline.h"
@@ -21,6 +22,9 @@
 #include "event-log.h"
 #include "work-stealing-deque.h"
 #include "gc-scan.h"
+#include "perf.h"
+#include "heap-census.h"
+#include "elastic.h"
 
 static Mutex_t		GCLock;		// Lock that protects the following variables:
 static Cond_t		LeaderWait;	// The leader waits on this for the followers
@@ -28,9 +32,13 @@ static Cond_t		FollowerWait;	// followers block on this until the leader starts
 static volatile int	NReadyForGC;	// number of vprocs that are ready for GC
 static volatile bool    GlobalGCInProgress; // true, when a global GC has been initiated
 static volatile bool	AllReadyForGC;	// true when all vprocs are ready to start GC
-static Barrier_t        GCBarrier0;	// for synchronizing on completion of setup phase
-static Barrier_t        GCBarrier1;	// for synchronizing on completion of copying phase
-static Barrier_t	GCBarrier2;	// for synchronizing on completion of GC
+static Cond_t		UnparkWait;	// parked vprocs wait on this for the GC to finish
+static int		NumParkedVProcs; // number of parked vprocs
+static volatile int	NNodesToSweep;	// number of nodes whose from-space has not
+					// been reclaimed yet
+static SpinBarrier_t	GCBarrier0;	// for synchronizing on completion of setup phase
+static SpinBarrier_t	GCBarrier1;	// for synchronizing on completion of copying phase
+static SpinBarrier_t	GCBarrier2;	// for synchronizing on completion of GC
 
 #if (! defined(NDEBUG)) || defined(ENABLE_LOGGING)
 /* summary statistics for global GC */
@@ -42,7 +50,11 @@ static uint64_t		NBytesCopied __attribute__((aligned(64)));
 uint64_t		GlobalGCUId;	// Unique ID of current global GC
 #endif
 
-static void GlobalGC (VProc_t *vp, Value_t **roots);
+static void GlobalGC (VProc_t *vp, Value_t **roots, bool leader);
+static void SweepNode (VProc_t *self, int node);
+static void FinishGlobalGC (VProc_t *self);
+static void ConvertParkedChunks (VProc_t *self);
+static void ForwardParkedRoots (VProc_t *self);
 static void ScanVProcHeap (VProc_t *vp);
 static void ScanGlobalToSpace (VProc_t *vp);
 #ifndef NDEBUG
@@ -104,6 +116,19 @@ Value_t ForwardObjGlobal (VProc_t *vp, Value_t v)
 	
 }
 
+/* wait at one of the GC barriers, recording the time spent waiting */
+STATIC_INLINE void GCBarrierWait (VProc_t *self, SpinBarrier_t *b)
+{
+#ifndef NO_GC_STATS
+    TIMER_Start (&(self->gcBarrierTimer));
+#endif
+    SpinBarrierWait (b, LocationNode(self->location));
+#ifndef NO_GC_STATS
+    TIMER_Stop (&(self->gcBarrierTimer));
+    self->nGCBarriers++;
+#endif
+}
+
 /* \brief initialize the data structures that support global GC
  */
 void InitGlobalGC ()
@@ -111,7 +136,12 @@ void InitGlobalGC ()
     MutexInit (&GCLock);
     CondInit (&LeaderWait);
     CondInit (&FollowerWait);
+    CondInit (&UnparkWait);
+    SpinBarrierInit (&GCBarrier0, NumVProcs);
+    SpinBarrierInit (&GCBarrier1, NumVProcs);
+    SpinBarrierInit (&GCBarrier2, NumVProcs);
     GlobalGCInProgress = false;
+    NumParkedVProcs = 0;
     NumGlobalGCs = 0;
 
 }
@@ -169,8 +199,7 @@ void StartGlobalGC (VProc_t *self, Value_t **roots)
 #endif
 
 #ifdef ENABLE_PERF_COUNTERS
-    PERF_StartGC(&self->misses);
-    PERF_StartGC(&self->reads);
+    PERF_PushPhase (self, PERF_GLOBAL_GC);
 #endif
 
     self->globalGCPending = false;
@@ -196,9 +225,11 @@ void StartGlobalGC (VProc_t *self, Value_t **roots)
 	    FromSpaceSzb = 0;
 	    NBytesCopied = 0;
 #endif
-	  /* signal the other vprocs that GlobalGC is needed */
+	  /* signal the other vprocs that GlobalGC is needed; parked vprocs do
+	   * not take part.
+	   */
 	    for (int i = 0;  i < NumVProcs;  i++) {
-		if (VProcs[i] != self)
+		if ((VProcs[i] != self) && !VProcs[i]->parked)
 		    VProcGlobalGCInterrupt (self, VProcs[i]);
 	    }
 	}
@@ -211,21 +242,23 @@ void StartGlobalGC (VProc_t *self, Value_t **roots)
       // leader to say "go"
 	if (leaderVProc) {
 	  /* wait for the other vprocs to start global GC */
-	    while (NReadyForGC < NumVProcs)
+	    int nActive = NumVProcs - NumParkedVProcs;
+	    while (NReadyForGC < nActive)
 		CondWait(&LeaderWait, &GCLock);
 	  /* reset the size of to-space */
 	    ToSpaceSz = 0;
-	  /* all followers are ready to do GC, so initialize the barriers
-	   * and then wake them up.
+	  /* all followers are ready to do GC, so size the barriers to the
+	   * active vprocs on each node and then wake them up.
 	   */
-	    BarrierInit (&GCBarrier0, NumVProcs);
-	    BarrierInit (&GCBarrier1, NumVProcs);
-	    BarrierInit (&GCBarrier2, NumVProcs);
+	    SpinBarrierReset (&GCBarrier0, NumHWNodes, NumVProcsPerNode);
+	    SpinBarrierReset (&GCBarrier1, NumHWNodes, NumVProcsPerNode);
+	    SpinBarrierReset (&GCBarrier2, NumHWNodes, NumVProcsPerNode);
+	    NNodesToSweep = NumHWNodes;
 	    AllReadyForGC = true;
 	    CondBroadcast(&FollowerWait);
 	}
 	else {
-	    if (++NReadyForGC == NumVProcs)
+	    if (++NReadyForGC == NumVProcs - NumParkedVProcs)
 		CondSignal (&LeaderWait);
 	    while (! AllReadyForGC)
 	        CondWait (&FollowerWait, &GCLock);
@@ -240,7 +273,6 @@ void StartGlobalGC (VProc_t *self, Value_t **roots)
     MutexLock(&NodeHeaps[node].lock);
     assert(NodeHeaps[node].scannedTo == NULL);
     NodeHeaps[node].completed = false;
-    MemChunk_t *p;
 
     if (self->globAllocChunk != NULL) {
         self->globAllocChunk->usedTop = self->globNextW - WORD_SZB;
@@ -255,15 +287,18 @@ void StartGlobalGC (VProc_t *self, Value_t **roots)
     /* finish the GC setup for this vproc */
 	self->globAllocChunk = (MemChunk_t *)0;
 
+    if (leaderVProc)
+	ConvertParkedChunks (self);
+
     /* synchronize on every vproc finishing setup (so we know all
        from spaces are appropraitely tagged). */
-    BarrierWait (&GCBarrier0);
+    GCBarrierWait (self, &GCBarrier0);
 
   /* allocate the initial chunk for the vproc */
     AllocToSpaceChunk (self);
 
   /* start GC for this vproc */
-    GlobalGC (self, roots);
+    GlobalGC (self, roots, leaderVProc);
 
 #ifndef NDEBUG
     if (HeapCheck >= GC_DEBUG_GLOBAL) {
@@ -274,7 +309,7 @@ void StartGlobalGC (VProc_t *self, Value_t **roots)
 #endif
 
   /* synchronize on every vproc finishing GC */
-    BarrierWait (&GCBarrier1);
+    GCBarrierWait (self, &GCBarrier1);
 
 #ifndef NO_GC_STATS
     // compute the number of bytes copied in this GC on this vproc
@@ -286,78 +321,29 @@ void StartGlobalGC (VProc_t *self, Value_t **roots)
     // include in total for this GC
     FetchAndAddU64 (&NBytesCopied, (uint64_t)used);
 #endif
-    if (leaderVProc) {
-        // The leader counts all of the bytes copied to chunks other than
-        // those still being used as global allocation chunks for each
-        // vproc
-        for (int i = 0; i < NumHWNodes; i++) {
-            for (p = NodeHeaps[i].scannedTo;  p != (MemChunk_t *)0;  p = p->next) {
-                uint32_t used = p->usedTop - p->baseAddr;
-                self->globalStats.nBytesCopied += used;
-#if (! defined(NDEBUG)) || defined(ENABLE_LOGGING)
-                // include in total for this GC
-                FetchAndAddU64 (&NBytesCopied, (uint64_t)used);
-#endif
-            }
-        }
-    }
 #endif /* !NO_GC_STATS */
 
-    /* Phase 4
-     * the leader reclaims the from-space pages
-     * Technically, the locking is extraneous (since every other VProc
-     * will be waiting on the barrier below), but I may parallelize this
-     * in the future.
-     */
-    if (leaderVProc) {
-        MutexLock (&HeapLock);
-        for (int i = 0; i < NumHWNodes; i++) {
-            MutexLock(&NodeHeaps[i].lock);
-            assert(NodeHeaps[i].unscannedTo == NULL);
-            NodeHeaps[i].unscannedTo = NodeHeaps[i].scannedTo;
-            NodeHeaps[i].scannedTo = NULL;
-            MemChunk_t *cp = NodeHeaps[i].fromSpace;
-            NodeHeaps[i].fromSpace = (MemChunk_t *)0;
-            while (cp != (MemChunk_t *)0) {
-                cp->sts = FREE_CHUNK;
-                cp->usedTop = cp->baseAddr;
-#ifndef NDEBUG
-                
-                if (GCDebug >= GC_DEBUG_GLOBAL)
-                    SayDebug("[%2d]   Free-Space chunk %#tx..%#tx\n",
-                             self->id, cp->baseAddr, cp->baseAddr+cp->szB);
-#endif
-                MemChunk_t *cq = cp->next;
-                assert (i == cp->where);
-                cp->next = NodeHeaps[i].freeChunks;
-                NodeHeaps[i].freeChunks = cp;
-                cp = cq;
-            }
-            NodeHeaps[i].fromSpace = NULL;
-            MutexUnlock(&NodeHeaps[i].lock);
-        }
-        
-#ifndef NDEBUG
-        if (HeapCheck >= GC_DEBUG_GLOBAL)
-            CheckToSpacesAfterGlobalGC(self);
-#endif
-
-/* NOTE: at some point we may want to release memory back to the OS */
-	    GlobalGCInProgress = false;
-        MutexUnlock (&HeapLock);
-      // recalculate the ToSpaceLimit
-	Addr_t baseLimit = (HeapScaleNum * ToSpaceSz) / HeapScaleDenom;
-	baseLimit = (baseLimit < ToSpaceSz) ? ToSpaceSz : baseLimit;
-	ToSpaceLimit = baseLimit + (Addr_t)NumVProcs * (Addr_t)PER_VPROC_HEAP_SZB;
-#ifndef NDEBUG
-	if (GCDebug >= GC_DEBUG_GLOBAL)
-	    SayDebug("[%2d] ToSpaceLimit = %ldMb\n",
-		self->id, (unsigned long)(ToSpaceLimit >> 20));
-#endif
+  /* every vproc has finished scanning, so the census counts are complete */
+    if (leaderVProc && HeapCensusFlg)
+	HeapCensusReport (NumGlobalGCs);
+
+  /* Phase 4
+   * each node's from-space chunks are reclaimed by the lowest-numbered vproc on
+   * that node (which never parks), so the nodes are reclaimed in parallel.  The
+   * leader also takes the nodes that have no vprocs, and whoever finishes the
+   * last node completes the GC.
+   */
+    for (int i = 0;  i < NumHWNodes;  i++) {
+	if ((MinVProcPerNode[i] == self->id)
+	|| (leaderVProc && (MinVProcPerNode[i] == MAX_NUM_VPROCS))) {
+	    SweepNode (self, i);
+	    if (FetchAndDec(&NNodesToSweep) == 1)
+		FinishGlobalGC (self);
+	}
     }
 
   /* synchronize on from-space being reclaimed */
-    BarrierWait (&GCBarrier2);
+    GCBarrierWait (self, &GCBarrier2);
 
     LogGlobalGCEnd (self, NumGlobalGCs);
 
@@ -365,8 +351,7 @@ void StartGlobalGC (VProc_t *self, Value_t **roots)
     TIMER_Stop(&(self->globalStats.timer));
 #endif
 #ifdef ENABLE_PERF_COUNTERS
-    PERF_StopGC(&self->misses);
-    PERF_StopGC(&self->reads);
+    PERF_PopPhase (self);
 #endif
 
 #ifndef NDEBUG
@@ -381,9 +366,167 @@ void StartGlobalGC (VProc_t *self, Value_t **roots)
 
 } /* end of StartGlobalGC */
 
+/*! \brief withdraw the vproc from global GC, which is the last step of parking it.
+ *  \param vp the host vproc, whose local heap must be empty.
+ *  \return false if a global GC has been started, in which case the vproc must
+ *  take part in it.
+ */
+bool GlobalGCParkVProc (VProc_t *vp)
+{
+    int node = LocationNode(vp->location);
+
+    MutexLock (&GCLock);
+	if (GlobalGCInProgress || vp->globalGCPending) {
+	    MutexUnlock (&GCLock);
+	    return false;
+	}
+	vp->parked = true;
+	NumParkedVProcs++;
+	NumVProcsPerNode[node]--;
+    MutexUnlock (&GCLock);
+
+    return true;
+
+}
+
+/*! \brief return a parked vproc to global GC.  If a global GC is in progress, we
+ *  wait for it to finish.
+ *  \param vp the host vproc
+ */
+void GlobalGCUnparkVProc (VProc_t *vp)
+{
+    int node = LocationNode(vp->location);
+
+    MutexLock (&GCLock);
+	while (GlobalGCInProgress)
+	    CondWait (&UnparkWait, &GCLock);
+	vp->parked = false;
+	NumParkedVProcs--;
+	NumVProcsPerNode[node]++;
+    MutexUnlock (&GCLock);
+
+  /* the leader of a global GC takes the allocation chunk of a parked vproc */
+    if (vp->globAllocChunk == (MemChunk_t *)0)
+	AllocToSpaceChunk (vp);
+
+}
+
+/*! \brief reclaim a node's from-space chunks and make its scanned to-space
+ *  chunks available for scanning in the next GC.  The bytes copied to the
+ *  scanned chunks are added to the GC stats of the vproc doing the sweep.
+ */
+static void SweepNode (VProc_t *self, int node)
+{
+    NodeHeap_t *nh = &(NodeHeaps[node]);
+
+    MutexLock(&nh->lock);
+	assert(nh->unscannedTo == NULL);
+#ifndef NO_GC_STATS
+	for (MemChunk_t *p = nh->scannedTo;  p != (MemChunk_t *)0;  p = p->next) {
+	    uint32_t used = p->usedTop - p->baseAddr;
+	    self->globalStats.nBytesCopied += used;
+#if (! defined(NDEBUG)) || defined(ENABLE_LOGGING)
+	  // include in total for this GC
+	    FetchAndAddU64 (&NBytesCopied, (uint64_t)used);
+#endif
+	}
+#endif /* !NO_GC_STATS */
+	nh->unscannedTo = nh->scannedTo;
+	nh->scannedTo = NULL;
+	MemChunk_t *cp = nh->fromSpace;
+	nh->fromSpace = (MemChunk_t *)0;
+	while (cp != (MemChunk_t *)0) {
+	    cp->sts = FREE_CHUNK;
+	    cp->usedTop = cp->baseAddr;
+#ifndef NDEBUG
+	    if (GCDebug >= GC_DEBUG_GLOBAL)
+		SayDebug("[%2d]   Free-Space chunk %#tx..%#tx\n",
+		    self->id, cp->baseAddr, cp->baseAddr+cp->szB);
+#endif
+	    MemChunk_t *cq = cp->next;
+	    assert (node == cp->where);
+	    cp->next = nh->freeChunks;
+	    nh->freeChunks = cp;
+	    cp = cq;
+	}
+    MutexUnlock(&nh->lock);
+
+}
+
+/*! \brief complete the global GC once every node has been swept; this function
+ *  is called by the vproc that finishes the last node.
+ */
+static void FinishGlobalGC (VProc_t *self)
+{
+#ifndef NDEBUG
+    if (HeapCheck >= GC_DEBUG_GLOBAL)
+	CheckToSpacesAfterGlobalGC(self);
+#endif
+
+/* NOTE: at some point we may want to release memory back to the OS */
+    MutexLock (&HeapLock);
+	GlobalGCInProgress = false;
+    MutexUnlock (&HeapLock);
+  // release any vprocs that are waiting to unpark
+    MutexLock (&GCLock);
+	CondBroadcast (&UnparkWait);
+    MutexUnlock (&GCLock);
+  // recalculate the ToSpaceLimit
+    ResizeGlobalHeap ();
+  // die if the live data does not fit under -maxheap
+    CheckHeapLimit ();
+#ifndef NDEBUG
+    if (GCDebug >= GC_DEBUG_GLOBAL)
+	SayDebug("[%2d] ToSpaceLimit = %ldMb\n",
+	    self->id, (unsigned long)(ToSpaceLimit >> 20));
+#endif
+
+}
+
+/*! \brief the leader converts the global-heap allocation chunks of the parked
+ *  vprocs to from-space.
+ */
+static void ConvertParkedChunks (VProc_t *self)
+{
+    for (int i = 0;  i < NumVProcs;  i++) {
+	VProc_t *vp = VProcs[i];
+	if (! vp->parked || (vp->globAllocChunk == (MemChunk_t *)0))
+	    continue;
+	int node = LocationNode(vp->location);
+	MutexLock(&NodeHeaps[node].lock);
+	    vp->globAllocChunk->usedTop = vp->globNextW - WORD_SZB;
+	    assert (vp->globAllocChunk->next == NULL);
+	    ConvertToSpaceChunks (vp, vp->globAllocChunk);
+	MutexUnlock(&NodeHeaps[node].lock);
+	vp->globAllocChunk = (MemChunk_t *)0;
+    }
+
+}
+
+/*! \brief the leader forwards the roots of the parked vprocs.  Since a parked
+ *  vproc's local heap is empty, its roots are all in the global heap.
+ */
+static void ForwardParkedRoots (VProc_t *self)
+{
+    for (int i = 0;  i < NumVProcs;  i++) {
+	VProc_t *vp = VProcs[i];
+	if (! vp->parked)
+	    continue;
+	Value_t *roots[NUM_PARKED_ROOTS + M_NumDequeRoots(vp) + 1];
+	ParkedVProcRoots (vp, roots);
+	for (int j = 0;  roots[j] != 0;  j++) {
+	    Value_t p = *roots[j];
+	    if (isFromSpacePtr(p)) {
+		*roots[j] = ForwardObjGlobal(self, p);
+	    }
+	}
+    }
+
+}
+
 /* GlobalGC:
  */
-static void GlobalGC (VProc_t *vp, Value_t **roots)
+static void GlobalGC (VProc_t *vp, Value_t **roots, bool leader)
 {
     LogGlobalGCVPStart (vp);
 
@@ -401,6 +544,9 @@ static void GlobalGC (VProc_t *vp, Value_t **roots)
 	}
     }
 
+    if (leader)
+	ForwardParkedRoots (vp);
+
     ScanVProcHeap (vp);
 
     PushToSpaceChunks (vp, original, true);
@@ -427,6 +573,9 @@ static void ScanVProcHeap (VProc_t *vp)
     while (scanPtr < top) {
 		
 		Word_t hdr = *scanPtr++;	// get object header
+
+		if (HeapCensusFlg)
+		    CensusObj (vp, hdr);
 		
 		if (isVectorHdr(hdr)) {
 			//Word_t *nextScan = ptr;
@@ -536,6 +685,9 @@ static void ScanGlobalToSpace (VProc_t *vp)
         do {
             while (scanPtr < scanTop) {
                 Word_t hdr = *scanPtr++;	// get object header
+
+                if (HeapCensusFlg)
+                    CensusObj (vp, hdr);
 		
                 if (isVectorHdr(hdr)) {
                     //Word_t *nextScan = ptr;
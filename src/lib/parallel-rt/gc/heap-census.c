@@ -0,0 +1,104 @@
+/* heap-census.c
+ *
+ * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
+ * All rights reserved.
+ *
+ * The heap census reports the live data after each global GC.  The report for
+ * a GC has the following format:
+ *
+ *	global-gc <n> <total objects> <total bytes>
+ *	    <id> <objects> <bytes> <description>	(one per live object type)
+ *
+ * where the object types are sorted by decreasing number of bytes.  The
+ * description of an object type comes from the table emitted by the compiler.
+ */
+
+#include "manticore-rt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "vproc.h"
+#include "options.h"
+#include "heap-census.h"
+
+typedef struct {
+    int			id;
+    CensusCount_t	cnt;
+} CensusRow_t;
+
+bool			HeapCensusFlg = false;
+CensusCount_t		*CensusCounts[MAX_NUM_VPROCS];
+static FILE		*CensusFile;
+
+static int CompareRows (const void *a, const void *b);
+
+void InitHeapCensus (Options_t *opts)
+{
+    const char *file = GetStringEqOpt (opts, "-census", DFLT_CENSUS_FILE);
+
+    if (file == 0)
+	return;
+
+    if ((CensusFile = fopen(file, "w")) == NULL) {
+	Warning ("unable to open census file \"%s\"\n", file);
+	return;
+    }
+
+    for (int i = 0;  i < MAX_NUM_VPROCS;  i++) {
+	CensusCounts[i] = NEWVEC(CensusCount_t, tableLen);
+	memset (CensusCounts[i], 0, tableLen * sizeof(CensusCount_t));
+    }
+
+    HeapCensusFlg = true;
+
+}
+
+void HeapCensusReport (int gcNum)
+{
+    CensusRow_t	*rows = NEWVEC(CensusRow_t, tableLen);
+    uint64_t	totObjs = 0, totBytes = 0;
+    int		nRows = 0;
+
+  /* sum the counts of the vprocs and reset them for the next GC */
+    for (int id = 0;  id < tableLen;  id++) {
+	CensusCount_t cnt = { 0, 0 };
+	for (int i = 0;  i < NumVProcs;  i++) {
+	    cnt.nObjs += CensusCounts[i][id].nObjs;
+	    cnt.nBytes += CensusCounts[i][id].nBytes;
+	    CensusCounts[i][id].nObjs = 0;
+	    CensusCounts[i][id].nBytes = 0;
+	}
+	if (cnt.nObjs > 0) {
+	    rows[nRows].id = id;
+	    rows[nRows].cnt = cnt;
+	    nRows++;
+	    totObjs += cnt.nObjs;
+	    totBytes += cnt.nBytes;
+	}
+    }
+
+    qsort (rows, nRows, sizeof(CensusRow_t), CompareRows);
+
+    fprintf (CensusFile, "global-gc %d %" PRIu64 " %" PRIu64 "\n", gcNum, totObjs, totBytes);
+    for (int i = 0;  i < nRows;  i++) {
+	fprintf (CensusFile, "    %5d %10" PRIu64 " %12" PRIu64 " %s\n",
+	    rows[i].id, rows[i].cnt.nObjs, rows[i].cnt.nBytes, tableDesc[rows[i].id]);
+    }
+    fflush (CensusFile);
+
+    FREE (rows);
+
+}
+
+/* order rows by decreasing size */
+static int CompareRows (const void *a, const void *b)
+{
+    const CensusRow_t *ra = (const CensusRow_t *)a;
+    const CensusRow_t *rb = (const CensusRow_t *)b;
+
+    if (ra->cnt.nBytes > rb->cnt.nBytes) return -1;
+    else if (ra->cnt.nBytes < rb->cnt.nBytes) return 1;
+    else return (ra->id - rb->id);
+
+}
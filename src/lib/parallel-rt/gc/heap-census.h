@@ -0,0 +1,51 @@
+/* heap-census.h
+ *
+ * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
+ * All rights reserved.
+ *
+ * A census of the live objects in the heap, broken down by header ID.  When it
+ * is enabled with the -census option, the global collector counts the objects
+ * that it scans in the vproc heaps and in to-space; since these are exactly the
+ * live objects, the leader can report the live data by object type at the end
+ * of each global GC.
+ */
+
+#ifndef _HEAP_CENSUS_H_
+#define _HEAP_CENSUS_H_
+
+#include "manticore-rt.h"
+#include "options.h"
+#include "gc-inline.h"
+
+#define DFLT_CENSUS_FILE	"census.out"
+
+typedef struct {
+    uint64_t	nObjs;		// number of live objects
+    uint64_t	nBytes;		// number of live bytes (including headers)
+} CensusCount_t;
+
+extern bool		HeapCensusFlg;		//!< true if the census is enabled
+extern CensusCount_t	*CensusCounts[MAX_NUM_VPROCS]; //!< per-vproc counts indexed by ID
+
+/*! \brief process the census command-line options */
+extern void InitHeapCensus (Options_t *opts);
+
+/*! \brief report and reset the census counts of all of the vprocs.
+ *  \param gcNum the number of the global GC
+ */
+extern void HeapCensusReport (int gcNum);
+
+/*! \brief add an object to the vproc's census counts.
+ *  \param vp the host vproc
+ *  \param hdr the object's header
+ */
+STATIC_INLINE void CensusObj (VProc_t *vp, Word_t hdr)
+{
+    int id = getID(hdr);
+    assert (id < tableLen);
+    CensusCount_t *cnt = &(CensusCounts[vp->id][id]);
+    cnt->nObjs++;
+    cnt->nBytes += WORD_SZB * (GetLength(hdr) + 1);
+}
+
+#endif /* !_HEAP_CENSUS_H_ */
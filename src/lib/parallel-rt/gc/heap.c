@@ -5,6 +5,7 @@
  */
 
 #include <inttypes.h>
+#include <stdio.h>
 #include "manticore-rt.h"
 #include "heap.h"
 #include "vproc.h"
@@ -14,9 +15,9 @@
 #include "os-threads.h"
 #include "options.h"
 #include "internal-heap.h"
+#include "heap-census.h"
 #ifndef NO_GC_STATS
 #include <string.h>
-#include <stdio.h>
 #endif
 
 Mutex_t		HeapLock;	/* lock for protecting heap data structures */
@@ -28,6 +29,7 @@ Addr_t		ToSpaceSz;	/* amount of memory being used for to-space */
 Addr_t		ToSpaceLimit;	/* if ToSpaceSz exceeds this value, then do a */
 				/* global GC */
 Addr_t		TotalVM = 0;	/* total memory used by heap (including vproc local heaps) */
+Addr_t		MaxHeapSzB = 0;	/* upper bound on TotalVM (0 for no bound) */
 Addr_t		MaxNurserySzB;	/* limit on size of nursery in vproc heap */
 Addr_t		MajorGCThreshold; /* when the size of the nursery goes below this limit */
 				/* it is time to do a GC. */
@@ -45,6 +47,16 @@ uint32_t	NumGlobalGCs = 0;
  * then we use
  *
  *	(HeapScaleNum * ToSpaceSz) / HeapScaleDenom + NumVProcs * PerVprocHeapSzb
+ *
+ * When the heap is capped (-maxheap or MAX_HEAP_SZB), the limit is further
+ * bounded by half of the memory that the cap leaves for the global heap, since
+ * the next global GC needs room for both from-space and to-space.  This bound
+ * shrinks the effective scale factor, and so triggers global GCs earlier, as the
+ * live data approaches the cap.  Running out of chunks while the heap is above
+ * HEAP_PRESSURE_PCT percent of the cap also forces a global GC.  The cap is not
+ * enforced while allocating chunks, since a global GC may need to go past it
+ * for a moment; instead, the heap is exhausted when the live data after a
+ * global GC does not fit under the cap (see CheckHeapLimit).
  */
 Addr_t		HeapScaleNum = 5;
 Addr_t		HeapScaleDenom = 4;
@@ -103,11 +115,15 @@ void HeapInit (Options_t *opts)
 	Die ("base global tospace scale %d/%d <= 1\n",
 	    (int)HeapScaleNum, (int)HeapScaleDenom);
     }
+    MaxHeapSzB = GetSizeConfig ("MAX_HEAP_SZB", ONE_MEG, 0);
+    MaxHeapSzB = GetSizeOpt (opts, "-maxheap", ONE_MEG, MaxHeapSzB);
 
 #ifndef NO_GC_STATS
     ParseGCStatsOptions (opts);
 #endif
 
+    InitHeapCensus (opts);
+
 #ifndef NDEBUG
     const char *debug = GetStringOpt (opts, "-gcdebug", DebugFlg ? GC_DEBUG_DEFAULT : "none");
     GCDebug = ParseGCLevel (debug);
@@ -120,6 +136,7 @@ void HeapInit (Options_t *opts)
 	SayDebug("          BaseHeapSzB = %lld\n", (long long)BaseHeapSzB);
 	SayDebug("          PerVprocHeapSzb = %lld\n", (long long)PerVprocHeapSzb);
 	SayDebug("          Tospace scale = %d/%d\n", (int)HeapScaleNum, (int)HeapScaleDenom);
+	SayDebug("          MaxHeapSzB = %lld\n", (long long)MaxHeapSzB);
     }
 #endif
 
@@ -140,7 +157,7 @@ void HeapInit (Options_t *opts)
     GlobalVM = 0;
     FreeVM = 0;
     ToSpaceSz = 0;
-    ToSpaceLimit = BaseHeapSzB; // we don't know the number of vprocs yet!
+    ToSpaceLimit = BaseHeapSzB; // we don't know the number of vprocs yet; see InitToSpaceLimit
     TotalVM = 0;
     FromSpaceChunks = (MemChunk_t *)0;
     
@@ -159,6 +176,31 @@ void HeapInit (Options_t *opts)
 
 } /* end of HeapInit */
 
+static void HeapExhausted ();
+
+/*! \brief bound the initial to-space limit by the heap cap.  This function is
+ *  called by VProcInit once NumVProcs is known, but before the vprocs are created.
+ */
+void InitToSpaceLimit ()
+{
+    if (MaxHeapSzB > 0) {
+      /* leave room under the cap for the vproc heaps and for one to-space chunk
+       * per vproc, which is what the vprocs can allocate between the time that
+       * ToSpaceLimit is reached and the start of the global GC.
+       */
+	Addr_t headroom = (Addr_t)NumVProcs * (VP_HEAP_SZB + HEAP_CHUNK_SZB);
+	Addr_t limit = (MaxHeapSzB > headroom) ? MaxHeapSzB - headroom : 0;
+	if (ToSpaceLimit > limit)
+	    ToSpaceLimit = limit;
+    }
+
+#ifndef NDEBUG
+    if (GCDebug > GC_DEBUG_NONE)
+	SayDebug("InitToSpaceLimit: ToSpaceLimit = %lld\n", (long long)ToSpaceLimit);
+#endif
+
+}
+
 /* InitVProcHeap:
  */
 void InitVProcHeap (VProc_t *vp)
@@ -190,6 +232,15 @@ void AllocToSpaceChunk (VProc_t *vp)
 
 	if (NodeHeaps[node].freeChunks == (MemChunk_t *)0) {
 	  /* no free chunks on this node, so allocate storage from OS */
+	    if (MaxHeapSzB > 0) {
+	      /* we do not check the cap here, since the global GC itself may have
+	       * to grow the heap past it; CheckHeapLimit reports the exhaustion
+	       * once the GC is done.
+	       */
+		Addr_t newVM = TotalVM + HEAP_CHUNK_SZB + BIBOP_PAGE_SZB;
+		if (newVM > (MaxHeapSzB / 100) * HEAP_PRESSURE_PCT)
+		    ToSpaceLimit = ToSpaceSz;  // force a global GC soon
+	    }
 	    int nPages = HEAP_CHUNK_SZB >> PAGE_BITS;
         void *allocBase;
 	    memObj = AllocMemory(&nPages, BIBOP_PAGE_SZB, nPages, &allocBase);
@@ -202,6 +253,7 @@ void AllocToSpaceChunk (VProc_t *vp)
 	    chunk->szB = nPages * BIBOP_PAGE_SZB;
 	    chunk->where = node;
 	    UpdateBIBOP (chunk);
+	    GlobalVM += chunk->szB;
 	}
 	else {
 	    chunk = NodeHeaps[node].freeChunks;
@@ -244,6 +296,76 @@ void AllocToSpaceChunk (VProc_t *vp)
 
 }
 
+/*! \brief compute the to-space size that triggers the next global GC; this
+ *  function is called at the end of each global GC.
+ */
+void ResizeGlobalHeap ()
+{
+    Addr_t baseLimit = (HeapScaleNum * ToSpaceSz) / HeapScaleDenom;
+    baseLimit = (baseLimit < ToSpaceSz) ? ToSpaceSz : baseLimit;
+    Addr_t limit = baseLimit + (Addr_t)NumVProcs * (Addr_t)PER_VPROC_HEAP_SZB;
+
+    if (MaxHeapSzB > 0) {
+      /* the vproc heaps are the part of TotalVM that is not global heap */
+	Addr_t localVM = TotalVM - GlobalVM;
+	Addr_t availSzB = (MaxHeapSzB > localVM) ? (MaxHeapSzB - localVM) / 2 : 0;
+      /* leave each vproc at least one chunk to allocate into, so that we do not
+       * collect on every major GC when the live data is close to the bound.
+       */
+	Addr_t minLimit = ToSpaceSz + (Addr_t)NumVProcs * HEAP_CHUNK_SZB;
+	if (availSzB < minLimit)
+	    availSzB = minLimit;
+	if (limit > availSzB)
+	    limit = availSzB;
+    }
+
+    ToSpaceLimit = limit;
+
+}
+
+/*! \brief check that the live data fits under the heap cap; this function is
+ *  called at the end of each global GC, after ResizeGlobalHeap.
+ */
+void CheckHeapLimit ()
+{
+    if (MaxHeapSzB == 0)
+	return;
+
+    MutexLock (&HeapLock);
+      /* the vproc heaps are the part of TotalVM that is not global heap */
+	Addr_t liveSzB = (TotalVM - GlobalVM) + ToSpaceSz;
+	if (liveSzB > MaxHeapSzB)
+	    HeapExhausted ();
+    MutexUnlock (&HeapLock);
+
+}
+
+/*! \brief report the state of the heap and exit.  This function is called,
+ *  with the HeapLock held, when the live data after a global GC exceeds the cap.
+ */
+static void HeapExhausted ()
+{
+    Error ("heap limit of %" PRIu64 "Mb exceeded\n", (uint64_t)(MaxHeapSzB >> 20));
+    fprintf (stderr, "  total heap memory:    %8" PRIu64 "Kb\n", (uint64_t)(TotalVM >> 10));
+    fprintf (stderr, "  vproc heaps:          %8" PRIu64 "Kb\n", (uint64_t)((TotalVM - GlobalVM) >> 10));
+    fprintf (stderr, "  global heap:          %8" PRIu64 "Kb\n", (uint64_t)(GlobalVM >> 10));
+    fprintf (stderr, "  to-space in use:      %8" PRIu64 "Kb\n", (uint64_t)(ToSpaceSz >> 10));
+    fprintf (stderr, "  to-space limit:       %8" PRIu64 "Kb\n", (uint64_t)(ToSpaceLimit >> 10));
+    fprintf (stderr, "  global GCs:           %8d\n", (int)NumGlobalGCs);
+    for (int i = 0;  i < NumHWNodes;  i++) {
+	int nFrom = 0, nTo = 0;
+	for (MemChunk_t *p = NodeHeaps[i].fromSpace;  p != (MemChunk_t *)0;  p = p->next)
+	    nFrom++;
+	for (MemChunk_t *p = NodeHeaps[i].unscannedTo;  p != (MemChunk_t *)0;  p = p->next)
+	    nTo++;
+	for (MemChunk_t *p = NodeHeaps[i].scannedTo;  p != (MemChunk_t *)0;  p = p->next)
+	    nTo++;
+	fprintf (stderr, "  node %2d: %d from-space and %d to-space chunks\n", i, nFrom, nTo);
+    }
+    Die ("live data does not fit in -maxheap %" PRIu64 "Mb", (uint64_t)(MaxHeapSzB >> 20));
+
+}
+
 /*! \brief Allocate a VProc's local memory object.
  */
 Addr_t AllocVProcMemory (int id, Location_t loc)
@@ -422,6 +544,8 @@ void ReportGCStats ()
     GCSummary_t totGlobal = { 0, 0, 0, 0.0 };
     uint64_t nBytesPromoted = 0;
     double totPromoteTime = 0.0;
+    uint64_t nGCBarriers = 0;
+    double totBarrierTime = 0.0;
     for (int i = 0;  i < NumVProcs;  i++) {
 	VProc_t *vp = VProcs[i];
 	double t = TIMER_GetTime (&(vp->timer));
@@ -450,6 +574,9 @@ void ReportGCStats ()
 
 	nBytesPromoted += vp->nBytesPromoted;
 	totPromoteTime += TIMER_GetTime (&(vp->promoteTimer));
+
+	nGCBarriers += vp->nGCBarriers;
+	totBarrierTime += TIMER_GetTime (&(vp->gcBarrierTimer));
     }
 
     if (CSVStatsFlg) {
@@ -569,6 +696,14 @@ void ReportGCStats ()
 	PrintPct (outF, totGlobal.nBytesCopied, totGlobal.nBytesCollected);
 	PrintTime (outF, timeScale * totGlobal.time);
 	fprintf (outF, "\n");
+      // report the time spent waiting at the global-GC barriers
+	if (nGCBarriers > 0) {
+	    fprintf (outF, "global-GC barriers: %" PRIu64 " waits, %.1f us average wait",
+		nGCBarriers, 1.0e6 * totBarrierTime / (double)nGCBarriers);
+	    if (totGlobal.time > 0.0)
+		fprintf (outF, " (%.1f%% of global-GC time)", 100.0 * totBarrierTime / totGlobal.time);
+	    fprintf (outF, "\n");
+	}
     }
     
     if (outF != stderr) {
@@ -63,6 +63,9 @@ typedef struct {
 #  define BASE_GLOBAL_HEAP_SZB	(ONE_K * ONE_MEG)
 #  define PER_VPROC_HEAP_SZB	(32 * ONE_MEG)
 #endif
+#define HEAP_PRESSURE_PCT	90	/*!< force a global GC when a new chunk is needed
+					 * and the heap is above this percentage of
+					 * MaxHeapSzB */
 
 extern Mutex_t		HeapLock;	/*!< lock for protecting heap data structures */
 extern Addr_t		GlobalVM;	/*!< amount of memory allocated to Global heap
@@ -73,6 +76,7 @@ extern Addr_t		ToSpaceLimit;	/*!< if ToSpaceSz exceeds this value, then do a
 					 * global GC */
 extern Addr_t		TotalVM;	/*!< total memory used by heap (including vproc
 					 * local heaps) */
+extern Addr_t		MaxHeapSzB;	/*!< upper bound on TotalVM (0 for no bound) */
 extern NodeHeap_t   *NodeHeaps; /*!< list of per-node heap information */
 
 extern Addr_t		HeapScaleNum;
@@ -85,6 +89,8 @@ extern void UpdateBIBOP (MemChunk_t *chunk);
 extern void FreeChunk (MemChunk_t *);
 
 /* GC routines */
+extern void ResizeGlobalHeap ();
+extern void CheckHeapLimit ();
 extern void InitGlobalGC ();
 extern void StartGlobalGC (VProc_t *self, Value_t **roots);
 extern MemChunk_t *PushToSpaceChunks (VProc_t *vp, MemChunk_t *scanChunk, bool inGlobal);
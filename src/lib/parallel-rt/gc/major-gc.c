@@ -23,6 +23,7 @@
 #include "bibop.h"
 #endif
 #include "gc-scan.h"
+#include "perf.h"
 #include <stdio.h>
 #include <inttypes.h>
 
@@ -131,6 +132,9 @@ void MajorGC (VProc_t *vp, Value_t **roots, Addr_t top)
     vp->majorStats.nBytesCollected += top - heapBase;
     TIMER_Start(&(vp->majorStats.timer));
 #endif
+#ifdef ENABLE_PERF_COUNTERS
+    PERF_PushPhase (vp, PERF_MAJOR_GC);
+#endif
 
     assert (heapBase <= vp->oldTop);
     assert (vp->oldTop <= top);
@@ -216,6 +220,9 @@ void MajorGC (VProc_t *vp, Value_t **roots, Addr_t top)
     }
 #endif /* !NDEBUG */
 #endif /* !NO_GC_STATS */
+#ifdef ENABLE_PERF_COUNTERS
+    PERF_PopPhase (vp);
+#endif
 
     PushToSpaceChunks (vp, scanChunk, false);
 
@@ -249,6 +256,9 @@ Value_t PromoteObj (VProc_t *vp, Value_t root)
     vp->nPromotes++;
     TIMER_Start(&(vp->promoteTimer));
 #endif
+#ifdef ENABLE_PERF_COUNTERS
+    PERF_PushPhase (vp, PERF_PROMOTE);
+#endif
 
     assert ((vp->globNextW % WORD_SZB) == 0);
 #ifndef NDEBUG
@@ -312,6 +322,9 @@ Value_t PromoteObj (VProc_t *vp, Value_t root)
     }
 #endif
 
+#ifdef ENABLE_PERF_COUNTERS
+    PERF_PopPhase (vp);
+#endif
 #ifndef NO_GC_STATS
     TIMER_Stop (&(vp->promoteTimer));
 #endif
@@ -20,6 +20,8 @@
 #include "work-stealing-deque.h"
 #include "bibop.h"
 #include "gc-scan.h"
+#include "perf.h"
+#include "alloc-prof.h"
 
 extern Addr_t   MajorGCThreshold;   /* when the size of the nursery goes below */
                     /* this limit it is time to do a GC. */
@@ -67,6 +69,9 @@ void MinorGC (VProc_t *vp)
 #ifndef NO_GC_STATS
     TIMER_Start(&(vp->minorStats.timer));
 #endif
+#ifdef ENABLE_PERF_COUNTERS
+    PERF_PushPhase (vp, PERF_MINOR_GC);
+#endif
 
     assert (vp->heapBase <= (Addr_t)nextScan);
     assert ((Addr_t)nextScan < vp->nurseryBase);
@@ -122,6 +127,9 @@ void MinorGC (VProc_t *vp)
         assert ((Addr_t)(nextW-1) <= vp->nurseryBase);
 
         Word_t hdr = *nextScan++;   // get object header
+
+        if (AllocProfFlg)
+            AllocProfSurvivor (vp, hdr);
         
         if (isVectorHdr(hdr)) {
             //Word_t *nextScan = ptr;
@@ -162,6 +170,9 @@ void MinorGC (VProc_t *vp)
     vp->majorStats.nBytesAlloc += (Addr_t)nextScan - vp->oldTop;
     TIMER_Stop(&(vp->minorStats.timer));
 #endif
+#ifdef ENABLE_PERF_COUNTERS
+    PERF_PopPhase (vp);
+#endif
 
 #ifndef NDEBUG
     if (GCDebug >= GC_DEBUG_MINOR) {
@@ -83,6 +83,7 @@ void *AllocMemory (int *nBlocks, int blkSzB, int minNumBlocks, void **unalignedB
 
     assert (((uint64_t)base)+(*nBlocks*blkSzB) <= ((uint64_t)memObj)+szb);
 
+    TotalVM += szb;
     *unalignedBase = memObj;
     return base;
 } /* end of AllocMemory */
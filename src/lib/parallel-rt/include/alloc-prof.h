@@ -0,0 +1,45 @@
+/* alloc-prof.h
+ *
+ * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
+ * All rights reserved.
+ *
+ * Allocation-site profiling.  When a program is compiled with -allocprof, the
+ * compiler numbers its local-heap allocation sites and instruments each one to
+ * increment the site's object and byte counters in the vproc's allocSiteCnts
+ * array.  Mixed objects allocated at an instrumented site have a header ID that
+ * is private to the site, so the minor GC can attribute the objects that survive
+ * it to their allocation site.
+ */
+
+#ifndef _ALLOC_PROF_H_
+#define _ALLOC_PROF_H_
+
+#include "manticore-rt.h"
+#include "options.h"
+
+#define DFLT_ALLOC_PROF_FILE	"allocprof.out"
+
+/* an entry in the table of allocation sites; generated by the compiler */
+typedef struct {
+    const char	*desc;		// the function and variable of the site
+    Word_t	hdrId;		// the header ID of the site's objects
+} AllocSite_t;
+
+extern bool	AllocProfFlg;		//!< true if the program has instrumented sites
+
+/*! \brief process the allocation-profiling options */
+extern void InitAllocProf (Options_t *opts);
+
+/*! \brief allocate the counters of a vproc */
+extern void AllocProfStartVProc (VProc_t *vp);
+
+/*! \brief record an object that has survived a minor GC.
+ *  \param vp the host vproc
+ *  \param hdr the object's header
+ */
+extern void AllocProfSurvivor (VProc_t *vp, Word_t hdr);
+
+/*! \brief write the allocation profile */
+extern void WriteAllocProf ();
+
+#endif /* !_ALLOC_PROF_H_ */
@@ -0,0 +1,71 @@
+/* elastic.h
+ *
+ * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
+ * All rights reserved.
+ *
+ * Support for growing and shrinking the set of active vprocs at run time.  A
+ * vproc parks itself when it would otherwise go to sleep and either its ID is
+ * not below the target number of active vprocs (see M_SetNumActiveVProcs) or the
+ * idleness policy (enabled by -elastic) has asked it to park.  Before parking,
+ * the vproc promotes everything that it can reach to the global heap, so a parked
+ * vproc has an empty local heap and it does not take part in global collections;
+ * the leader of a global GC forwards the parked vproc's roots instead.  A parked
+ * vproc is unparked when a signal arrives on its landing pad, when the target is
+ * raised, or when the policy sees that all of the active vprocs are busy.
+ *
+ * The lowest-numbered vproc of each node never parks, since the global GC relies
+ * on every node having at least one vproc to scan its to-space chunks.  A parked
+ * vproc does not run its scheduler, so threads that are sleeping on it are delayed
+ * until it is unparked.
+ */
+
+#ifndef _ELASTIC_H_
+#define _ELASTIC_H_
+
+#include "manticore-rt.h"
+#include "options.h"
+
+#define DFLT_PARK_AFTER_MS	100	//!< default length of the idleness window
+#define PARK_IDLE_PCT		90	//!< park when idle for this much of the window
+#define UNPARK_BUSY_TICKS	2	//!< unpark after this many quanta with all vprocs busy
+#define NUM_PARKED_ROOTS	12	//!< number of vproc fields that are roots
+
+/*! \brief process the -elastic and -parkafter options.
+ *  \param opts the command-line options
+ *  \param timeQ the time quantum in milliseconds
+ */
+extern void InitElastic (Options_t *opts, int timeQ);
+
+/*! \brief park the host vproc, if it should be parked, and return once it has
+ *  been unparked.  This function is called in place of sleeping.
+ *  \param vp the host vproc
+ *  \param nsec the length of the sleep in nanoseconds (0 for no timeout); a parked
+ *  vproc is also unparked when the timeout expires.
+ *  \param status set to the result that VProcNanosleep would have returned (true
+ *  if the vproc was woken before the timeout), when the vproc was parked.
+ *  \return true if the vproc was parked.
+ */
+extern bool VProcParkIfIdle (VProc_t *vp, Time_t nsec, Value_t *status);
+
+/*! \brief sample the idleness of the vprocs and park or unpark vprocs according
+ *  to the policy; this function is called periodically by the PingLoop.
+ */
+extern void ElasticTick ();
+
+/*! \brief fill in the roots of a vproc that is parked or about to park.
+ *  \param vp the vproc
+ *  \param rp an array with room for NUM_PARKED_ROOTS+M_NumDequeRoots(vp)+1 roots
+ *  \return the end of the roots, which is 0 terminated.
+ */
+extern Value_t **ParkedVProcRoots (VProc_t *vp, Value_t **rp);
+
+/*! \brief set the target number of active vprocs. */
+extern void M_SetNumActiveVProcs (int n);
+
+/*! \brief return the number of vprocs that are not parked. */
+extern int M_GetNumActiveVProcs ();
+
+/*! \brief return 1 if the vproc is parked and 0 otherwise. */
+extern int M_VProcIsParked (VProc_t *vp);
+
+#endif /* !_ELASTIC_H_ */
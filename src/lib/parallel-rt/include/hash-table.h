@@ -0,0 +1,56 @@
+/* hash-table.h
+ *
+ * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
+ * All rights reserved.
+ *
+ * A lock-free hash table from int keys to ML values, which is the representation
+ * of the ConcurrentHashTable structure in the basis library.  The table lives in
+ * the global heap and is traced by the GC like any other object, so the ML code
+ * just holds on to the table object and passes it to these functions.  The values
+ * that are stored in the table must already be in the global heap.
+ */
+
+#ifndef _HASH_TABLE_H_
+#define _HASH_TABLE_H_
+
+#include "manticore-rt.h"
+#include "vproc.h"
+
+/*! \brief allocate an empty table.
+ *  \param vp the host vproc
+ *  \param sizeHint the expected number of entries
+ *  \return the new table
+ */
+extern Value_t M_HashTableNew (VProc_t *vp, int32_t sizeHint);
+
+/*! \brief look up the entry for a key.
+ *  \param tbl the table
+ *  \param key the key
+ *  \return the entry for the key or M_NIL.  An entry is an immutable object whose
+ *  first field is the value.
+ */
+extern Value_t M_HashTableFindEntry (Value_t tbl, int32_t key);
+
+/*! \brief add or replace the entry for a key.
+ *  \param vp the host vproc
+ *  \param tbl the table
+ *  \param key the key
+ *  \param v the value, which must be in the global heap
+ */
+extern void M_HashTableInsert (VProc_t *vp, Value_t tbl, int32_t key, Value_t v);
+
+/*! \brief replace the entry for a key, if it is still the given one.
+ *  \param vp the host vproc
+ *  \param tbl the table
+ *  \param key the key
+ *  \param old the entry that was returned by M_HashTableFindEntry, or M_NIL
+ *  \param v the new value, which must be in the global heap
+ *  \return 1 if the entry was replaced and 0 if it had changed in the meantime
+ */
+extern int32_t M_HashTableCompareAndSet (
+    VProc_t *vp, Value_t tbl, int32_t key, Value_t old, Value_t v);
+
+/*! \brief return the number of slots in the table's current store */
+extern int32_t M_HashTableCapacity (Value_t tbl);
+
+#endif /* !_HASH_TABLE_H_ */
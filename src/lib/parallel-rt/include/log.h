@@ -17,6 +17,11 @@ extern void InitLog (VProc_t *vp);
 extern void SwapLogBuffers (VProc_t *vp, LogBuffer_t *curBuf);
 extern void FinishLog ();
 
+extern void InitLogIndex ();
+extern uint64_t WriteLogBlock (int fd, const void *data, uint32_t szB);
+extern void IndexLogBlock (uint32_t vpId, uint64_t offset, uint32_t szB, uint64_t firstTS, uint64_t lastTS);
+extern void WriteLogIndex (int fd, uint32_t nVProcs);
+
 extern void InitEventLogFile (const char *name, int nvps, int ncpus);
 extern void InitEventLog (VProc_t *vp);
 extern void SwapEventLogBuffers (VProc_t *vp, LogBuffer_t *curBuf);
@@ -0,0 +1,29 @@
+/* metrics.h
+ *
+ * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
+ * All rights reserved.
+ *
+ * Live snapshots of the runtime's per-vproc counters.  When enabled with the
+ * -metrics option, the PingLoop thread writes a JSON snapshot of the GC,
+ * scheduler, and allocation counters whenever the process receives SIGUSR1
+ * and, optionally, every -metricsperiod milliseconds.
+ */
+
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#include "manticore-rt.h"
+
+extern bool	MetricsFlg;		//!< true if live metrics are enabled
+extern int	MetricsPeriod;		//!< milliseconds between snapshots (0 == only on SIGUSR1)
+
+/*! \brief process the metrics command-line options.  This function must be called
+ *  before the vprocs are created, since it blocks SIGUSR1 so that the signal is
+ *  only received by the PingLoop thread.
+ */
+extern void InitMetrics (Options_t *opts);
+
+/*! \brief write a snapshot of the runtime counters to the metrics file */
+extern void WriteMetrics ();
+
+#endif /* !_METRICS_H_ */
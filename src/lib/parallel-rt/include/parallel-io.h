@@ -0,0 +1,106 @@
+/* parallel-io.h
+ *
+ * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
+ * All rights reserved.
+ *
+ * Support for the ParallelIO structure in the basis library.  An input file is
+ * mapped into memory, so that the vprocs can parse disjoint byte ranges of it at
+ * the same time.  Byte ranges are given as half-open intervals [lo, hi) of file
+ * offsets.  Text records are lines; the fields of a line are separated by commas
+ * and/or white space.
+ *
+ * Rope files hold the leaves of a rope in a binary format; they are written by
+ * the vprocs in parallel, and read back through a mapped file.
+ */
+
+#ifndef _PARALLEL_IO_H_
+#define _PARALLEL_IO_H_
+
+#include "manticore-rt.h"
+#include "vproc.h"
+
+/*! \brief map a file into memory for reading.
+ *  \param filename the file's name (an ML string)
+ *  \return a handle for the mapped file, or 0 if the file could not be mapped
+ */
+extern void *M_MapFileIn (Value_t filename);
+
+/*! \brief unmap a file and free its handle (a 0 handle is ignored) */
+extern void M_UnmapFile (void *mf);
+
+/*! \brief return the size of a mapped file in bytes, or -1 for a 0 handle */
+extern int64_t M_MappedFileSize (void *mf);
+
+/*! \brief return the start of the first line that begins at or after pos.
+ *  \return a file offset in [pos, size]
+ */
+extern int64_t M_MappedRecordStart (void *mf, int64_t pos);
+
+/*! \brief return the end of the line that starts at pos (the offset of its
+ *  newline or hi).
+ */
+extern int64_t M_MappedLineEnd (void *mf, int64_t pos, int64_t hi);
+
+/*! \brief count the fields in a range */
+extern int32_t M_MappedCountFields (void *mf, int64_t lo, int64_t hi);
+
+/*! \brief parse the first n fields in [pos, hi) as numbers.
+ *  \return the offset following the last field that was parsed, or -1 if a field is
+ *  not a well-formed number or there are fewer than n fields.
+ */
+extern int64_t M_MappedParseInts (void *mf, int64_t pos, int64_t hi, int32_t *dst, int32_t n);
+extern int64_t M_MappedParseDoubles (void *mf, int64_t pos, int64_t hi, double *dst, int32_t n);
+
+/*! \brief copy n binary values in native byte order starting at the given offset */
+extern void M_MappedReadInts (void *mf, int64_t off, int32_t *dst, int32_t n);
+extern void M_MappedReadDoubles (void *mf, int64_t off, double *dst, int32_t n);
+
+/*! \brief allocate an ML string that holds the line in [lo, hi), minus any
+ *  trailing carriage return.
+ */
+extern Value_t M_MappedLine (VProc_t *vp, void *mf, int64_t lo, int64_t hi);
+
+/* element kinds of rope files */
+#define ROPE_FILE_INT		1	//!< int32_t
+#define ROPE_FILE_DOUBLE	2	//!< double
+#define ROPE_FILE_INT_DOUBLE	3	//!< int32_t * double (two columns)
+#define ROPE_FILE_DOUBLE_DOUBLE	4	//!< double * double (two columns)
+
+/*! \brief create a rope file and write its header.
+ *  \param filename the file's name (an ML string)
+ *  \param kind the element kind
+ *  \param nLeaves the number of leaves in the rope
+ *  \param nElems the number of elements in the rope
+ *  \return a handle for writing the leaves, or 0 on failure
+ */
+extern void *M_RopeFileCreate (Value_t filename, int32_t kind, int64_t nLeaves, int64_t nElems);
+
+/*! \brief write the ix'th leaf of a rope file; different leaves may be written
+ *  at the same time.
+ *  \param eltOff the number of elements in the leaves before this one
+ *  \param col0 the leaf's first column
+ *  \param col1 the leaf's second column (ignored for one-column kinds)
+ *  \param n the number of elements in the leaf
+ *  \return 1 on success, 0 on failure
+ */
+extern int32_t M_RopeFileWriteLeaf (void *rf, int64_t ix, int64_t eltOff, void *col0, void *col1, int32_t n);
+
+/*! \brief close a rope file after all of its leaves have been written
+ *  \return 1 on success, 0 on failure
+ */
+extern int32_t M_RopeFileClose (void *rf);
+
+/*! \brief check that a mapped file is a well-formed rope file of the given kind.
+ *  \return the number of leaves in the rope, or -1
+ */
+extern int64_t M_RopeFileNumLeaves (void *mf, int32_t kind);
+
+/*! \brief return the file offset of the ix'th leaf of a mapped rope file; its
+ *  columns are read with M_MappedReadInts and M_MappedReadDoubles.
+ */
+extern int64_t M_RopeFileLeafOffset (void *mf, int64_t ix);
+
+/*! \brief return the number of elements in the ix'th leaf of a mapped rope file */
+extern int32_t M_RopeFileLeafLength (void *mf, int64_t ix);
+
+#endif /* !_PARALLEL_IO_H_ */
@@ -10,13 +10,21 @@
 
 #include "manticore-rt.h"
 #if defined(TARGET_LINUX)
-#  include "linux/perf-counter.h"
+#  include <linux/perf_event.h>
 #endif
 
+extern int NumPerfEvents;
+
 extern void ParsePerfOptions (Options_t *opts);
 extern void InitPerfCounters (VProc_t *vp);
 extern void ReportPerfCounters ();
 
-extern void PERF_StartGC(PerfCntrs_t *p);
-extern void PERF_StopGC(PerfCntrs_t *p);
+extern const char *PerfEventName (int i);
+extern const char *PerfPhaseName (PerfPhase_t phase);
+
+/* enter/leave a phase; the counts between phase changes are attributed to the
+ * innermost active phase.
+ */
+extern void PERF_PushPhase (VProc_t *vp, PerfPhase_t phase);
+extern void PERF_PopPhase (VProc_t *vp);
 #endif /* !_PERF_H_ */
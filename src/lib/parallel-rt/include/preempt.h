@@ -0,0 +1,46 @@
+/* preempt.h
+ *
+ * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
+ * All rights reserved.
+ *
+ * Sources of timer preemption.  By default on Linux, each vproc has a POSIX
+ * timer that signals the vproc's host thread once per time quantum, and the
+ * signal handler preempts the vproc.  The -preempt option selects the older
+ * scheme, in which the PingLoop thread round-robin preempts the vprocs, or no
+ * timer preemption at all.
+ */
+
+#ifndef _PREEMPT_H_
+#define _PREEMPT_H_
+
+#include "manticore-rt.h"
+#include "options.h"
+
+typedef enum {
+    PREEMPT_TIMER,		//!< a per-vproc timer
+    PREEMPT_PING,		//!< the PingLoop thread preempts the vprocs
+    PREEMPT_NONE		//!< no timer preemption
+} PreemptMode_t;
+
+extern PreemptMode_t	PreemptMode;
+
+/*! \brief process the preemption options.
+ *  \param opts the command-line options
+ *  \param timeQ the time quantum in milliseconds
+ */
+extern void InitPreemption (Options_t *opts, int timeQ);
+
+/*! \brief start the preemption timer of a vproc; this function must be called
+ *  by the vproc's host thread.
+ */
+extern void PreemptStartVProc (VProc_t *vp);
+
+/*! \brief enable or disable the timer preemption of a vproc.  Disabling the
+ *  preemption does not affect the signals and GC requests from other vprocs.
+ */
+extern void VProcSetPreemption (VProc_t *vp, bool enable);
+
+/*! \brief report the timer jitter statistics (if enabled by -preemptstats) */
+extern void ReportPreemptStats ();
+
+#endif /* !_PREEMPT_H_ */
@@ -0,0 +1,44 @@
+/* profile.h
+ *
+ * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
+ * All rights reserved.
+ *
+ * A statistical profiler for Manticore programs.  When enabled with the -prof
+ * option, each vproc samples its program counter on a SIGPROF timer that counts
+ * the CPU time of its host thread.  At exit, the samples and the compiler-emitted
+ * function table (mantProfTbl) are written to the profile file, which can be
+ * processed by the mc-prof tool.
+ */
+
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+#include "manticore-rt.h"
+
+#define DFLT_PROF_FILE		"prof.out"
+#define DFLT_PROF_RATE		1000	/* samples per second of CPU time */
+
+/*! \brief an entry in the compiler-generated table that maps code addresses to
+ *  Manticore functions.  The table is terminated by an entry with a zero address.
+ */
+typedef struct {
+    Addr_t	addr;		//!< the function's entry address
+    const char	*name;		//!< the function's name
+} ProfTblEntry_t;
+
+extern bool ProfileFlg;		//!< true if profiling is enabled
+
+/*! \brief process the profiling options; this function must be called before the
+ *  vprocs are created.
+ */
+extern void InitProfiler (Options_t *opts);
+
+/*! \brief start sampling the calling vproc; this function must be called by the
+ *  vproc's host thread.
+ */
+extern void ProfStartVProc (VProc_t *vp);
+
+/*! \brief stop sampling and write the profile file */
+extern void WriteProfile ();
+
+#endif /* !_PROFILE_H_ */
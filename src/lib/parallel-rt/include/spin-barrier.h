@@ -0,0 +1,149 @@
+/* spin-barrier.h
+ *
+ * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
+ * All rights reserved.
+ *
+ * Spin-then-block barriers for the runtime's own phases (vproc startup and
+ * shutdown and the phases of the global GC).  The participants are split into
+ * groups (normally, one per node); each participant arrives at its group's
+ * counter and the last arriver of a group arrives at the root counter, so only
+ * one participant per node touches the shared cache line.  The barrier is
+ * released by advancing an episode number, which the waiters spin on for a
+ * bounded number of iterations before blocking on a condition variable.
+ *
+ * Because the episode number is never reset, a barrier can be resized (see
+ * SpinBarrierReset) while late waiters from the previous episode are still on
+ * their way out.
+ */
+
+#ifndef _SPIN_BARRIER_H_
+#define _SPIN_BARRIER_H_
+
+#include "manticore-rt.h"
+#include "os-threads.h"
+#include "atomic-ops.h"
+#include <sched.h>
+
+#define SPIN_BARRIER_MAX_GROUPS	16	//!< groups beyond this are folded together
+#define SPIN_BARRIER_SPIN_LIMIT	20000	//!< number of spins before blocking
+#define SPIN_BARRIER_YIELD_MASK	0x3ff	//!< yield the CPU once every 1024 spins
+
+typedef struct {
+    volatile int	count;		//!< number of arrivals in this episode
+    int			nProcs;		//!< number of participants in the group
+} __attribute__((aligned(64))) SpinBarrierGroup_t;
+
+typedef struct {
+    volatile int	episode __attribute__((aligned(64)));
+					//!< incremented on each release
+    volatile int	count;		//!< number of groups that have arrived
+    int			nGroups;	//!< number of non-empty groups
+    volatile int	nBlocked;	//!< number of waiters that are blocked
+    Mutex_t		lock;		//!< protects the blocking path
+    Cond_t		wait;		//!< blocked waiters wait on this
+    SpinBarrierGroup_t	groups[SPIN_BARRIER_MAX_GROUPS];
+} SpinBarrier_t;
+
+STATIC_INLINE void SpinPause ()
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __asm__ __volatile__ ("pause");
+#endif
+}
+
+/*! \brief set the number of participants per group; this function must not be
+ *  called while an episode is in progress.
+ *  \param b the barrier
+ *  \param nGroups the number of groups
+ *  \param groupSz the number of participants in each group
+ */
+STATIC_INLINE void SpinBarrierReset (SpinBarrier_t *b, int nGroups, const int *groupSz)
+{
+    for (int i = 0;  i < SPIN_BARRIER_MAX_GROUPS;  i++) {
+	b->groups[i].count = 0;
+	b->groups[i].nProcs = 0;
+    }
+    for (int i = 0;  i < nGroups;  i++)
+	b->groups[i % SPIN_BARRIER_MAX_GROUPS].nProcs += groupSz[i];
+    b->nGroups = 0;
+    for (int i = 0;  i < SPIN_BARRIER_MAX_GROUPS;  i++) {
+	if (b->groups[i].nProcs > 0)
+	    b->nGroups++;
+    }
+    b->count = 0;
+}
+
+/*! \brief initialize a barrier with a single group.  The barrier must be in
+ *  zero-initialized storage.
+ *  \param b the barrier
+ *  \param nProcs the number of participants
+ */
+STATIC_INLINE void SpinBarrierInit (SpinBarrier_t *b, int nProcs)
+{
+    MutexInit (&(b->lock));
+    CondInit (&(b->wait));
+    b->nBlocked = 0;
+    SpinBarrierReset (b, 1, &nProcs);
+}
+
+/*! \brief wait for the other participants to arrive.
+ *  \param b the barrier
+ *  \param group the caller's group
+ *  \return true for exactly one of the participants (the one that released the
+ *  barrier) and false for the others.
+ */
+STATIC_INLINE bool SpinBarrierWait (SpinBarrier_t *b, int group)
+{
+    SpinBarrierGroup_t *g = &(b->groups[group % SPIN_BARRIER_MAX_GROUPS]);
+    int episode = b->episode;
+
+    assert (g->nProcs > 0);
+    if (FetchAndInc(&(g->count)) == g->nProcs - 1) {
+      /* we are the last of our group, so we arrive at the root.  The counts are
+       * reset before the episode is advanced, since nobody can re-enter until then.
+       */
+	g->count = 0;
+	if (FetchAndInc(&(b->count)) == b->nGroups - 1) {
+	    b->count = 0;
+	    FetchAndInc (&(b->episode));
+	    if (b->nBlocked > 0) {
+		MutexLock (&(b->lock));
+		    CondBroadcast (&(b->wait));
+		MutexUnlock (&(b->lock));
+	    }
+	    return true;
+	}
+    }
+
+    for (int i = 0;  i < SPIN_BARRIER_SPIN_LIMIT;  i++) {
+	if (b->episode != episode)
+	    return false;
+      /* yield now and then, in case there are more participants than CPUs */
+	if ((i & SPIN_BARRIER_YIELD_MASK) == SPIN_BARRIER_YIELD_MASK)
+	    sched_yield ();
+	else
+	    SpinPause ();
+    }
+
+  /* NOTE: the increment of nBlocked and the increment of the episode are both
+   * atomic, so either we see the new episode or the releaser sees that we are
+   * blocked and takes the lock to broadcast.
+   */
+    MutexLock (&(b->lock));
+	FetchAndInc (&(b->nBlocked));
+	while (b->episode == episode)
+	    CondWait (&(b->wait), &(b->lock));
+	FetchAndDec (&(b->nBlocked));
+    MutexUnlock (&(b->lock));
+
+    return false;
+}
+
+STATIC_INLINE void SpinBarrierDestroy (SpinBarrier_t *b)
+{
+    assert (b->nBlocked == 0);
+    MutexDestroy (&(b->lock));
+    CondDestroy (&(b->wait));
+}
+
+#endif /* !_SPIN_BARRIER_H_ */
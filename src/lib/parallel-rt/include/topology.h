@@ -39,8 +39,14 @@ extern int		NumCoresPerNode; //!< \brief number of cores per thread
 extern int		NumThdsPerCore; //!< \brief number of threads per core
 extern Location_t	*Locations;	//!< \brief an array of the available
 					//!  locations indexed by processor ID
+extern Location_t	*SpreadLocations; //!< \brief the available locations ordered
+					//!  round-robin by node, then core, then thread
+extern int		NumUsableCPUs;	//!< \brief number of CPUs that we are allowed to
+					//!  use (limited by the cgroup CPU quota)
 
 /*! \brief initialization function that determines the hardware topology.
+ *  On Linux, the topology only includes the processors in the process's
+ *  affinity mask (e.g., the cpuset of a container).
  */
 void DiscoverTopology ();
 
@@ -74,6 +80,9 @@ STATIC_INLINE int LogicalId (Location_t loc)
     return id;
 }
 
+/*! \brief return the operating-system processor ID of the location. */
+int LocationCPU (Location_t loc);
+
 /*! \brief are two locations on the same node? */
 STATIC_INLINE bool SameNodeLocation (Location_t loc1, Location_t loc2)
 {
@@ -70,6 +70,8 @@ STATIC_INLINE Value_t Some (VProc_t *vp, Value_t a)
 extern Value_t GlobalAllocUniform (VProc_t *vp, int nItems, ...);
 extern Value_t GlobalAllocNonUniform (VProc_t *vp, int nItems, ...);
 extern Value_t GlobalAllocArray (VProc_t *vp, int nElems, Value_t elt);
+extern Value_t GlobalAllocPolyArray (VProc_t *vp, int nElems, Value_t init);
+extern Value_t GlobalAllocRawArray (VProc_t *vp, int nElems, int szBOfElt);
 
 STATIC_INLINE Value_t GlobalCons (VProc_t *vp, Value_t a, Value_t b)
 {
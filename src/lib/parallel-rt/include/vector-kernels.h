@@ -0,0 +1,53 @@
+/* vector-kernels.h
+ *
+ * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
+ * All rights reserved.
+ *
+ * Leaf kernels over unboxed int and double arrays, which the IntRope and
+ * DoubleRope code calls through the C-call interface.  Each kernel has an AVX2
+ * version and a scalar fallback; the AVX2 versions are used when the processor
+ * supports them and the -novec option is not given.  The kernels do not
+ * allocate, so the array pointers that they are given stay valid.
+ */
+
+#ifndef _VECTOR_KERNELS_H_
+#define _VECTOR_KERNELS_H_
+
+#include "manticore-rt.h"
+#include "options.h"
+
+/*! \brief select the kernel implementation.
+ *  \param opts the command-line options
+ */
+extern void InitVectorKernels (Options_t *opts);
+
+/* reductions; for the min and max kernels, n must be positive.  Int arithmetic
+ * wraps around on overflow.  The double sums are computed in a different order
+ * than a sequential left-to-right sum, so they may differ in the last bits.
+ */
+extern int32_t M_IntSum (int32_t *a, int n);
+extern int32_t M_IntMin (int32_t *a, int n);
+extern int32_t M_IntMax (int32_t *a, int n);
+extern int32_t M_IntDot (int32_t *a, int32_t *b, int n);
+extern double M_DoubleSum (double *a, int n);
+extern double M_DoubleMin (double *a, int n);
+extern double M_DoubleMax (double *a, int n);
+extern double M_DoubleDot (double *a, double *b, int n);
+
+/* exclusive prefix sums: dst[i] = init + a[0] + ... + a[i-1]; the result is the
+ * sum of init and all of the elements.  The double version adds from left to
+ * right, so it matches the sequential scan exactly.
+ */
+extern int32_t M_IntPrefixSum (int32_t *dst, int32_t *a, int n, int32_t init);
+extern double M_DoublePrefixSum (double *dst, double *a, int n, double init);
+
+/* element-wise arithmetic: dst[i] = a[i] op b[i] */
+extern void M_IntAdd (int32_t *dst, int32_t *a, int32_t *b, int n);
+extern void M_IntSub (int32_t *dst, int32_t *a, int32_t *b, int n);
+extern void M_IntMul (int32_t *dst, int32_t *a, int32_t *b, int n);
+extern void M_DoubleAdd (double *dst, double *a, double *b, int n);
+extern void M_DoubleSub (double *dst, double *a, double *b, int n);
+extern void M_DoubleMul (double *dst, double *a, double *b, int n);
+extern void M_DoubleScale (double *dst, double *a, double s, int n);
+
+#endif /* !_VECTOR_KERNELS_H_ */
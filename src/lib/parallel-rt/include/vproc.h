@@ -30,13 +30,31 @@ typedef struct {	    //!< counters for a GC
 #endif
 
 #ifdef ENABLE_PERF_COUNTERS
-typedef struct {    //!< a perf counter
-    uint64_t    nonGC;//!< nonGC perf counter value
-    uint64_t    GC;    //!< perf counter value during gc
-    uint64_t    last;   //!< previous value of the counter at last state change
-    bool        inGC;   //!< true if we're currently recording GC-specific data
-    int         fd;     //!< file descriptor associated with perf counter
-    bool        enabled;//!< true if perf counters are enabled for this vproc
+#define MAX_PERF_EVENTS		8	//!< maximum number of perf events per vproc
+#define MAX_PERF_DEPTH		6	//!< maximum nesting of perf phases
+
+typedef enum {	    //!< the phases that perf-event counts are attributed to
+    PERF_MUTATOR,		//!< running Manticore code
+    PERF_MINOR_GC,		//!< minor GC
+    PERF_MAJOR_GC,		//!< major GC
+    PERF_GLOBAL_GC,		//!< this vproc's part in a global GC
+    PERF_PROMOTE,		//!< promotion of an object to the global heap
+    PERF_IDLE,			//!< sleeping while waiting for work
+    NUM_PERF_PHASES
+} PerfPhase_t;
+
+typedef struct {    //!< the perf counters for a vproc
+    int		nEvents;	//!< number of events counted (0 if disabled)
+    int		fd[MAX_PERF_EVENTS];
+				//!< file descriptors of the counters; fd[0] is
+				//!  the group leader
+    uint64_t	last[MAX_PERF_EVENTS];
+				//!< counter values at the last phase change
+    uint64_t	counts[NUM_PERF_PHASES][MAX_PERF_EVENTS];
+				//!< event counts per phase
+    int		depth;		//!< depth of the phase stack
+    PerfPhase_t	phases[MAX_PERF_DEPTH];
+				//!< the active phases; phases[depth-1] is current
 } PerfCntrs_t;
 #endif
 
@@ -65,6 +83,7 @@ struct struct_vproc {
     Value_t	stdCont;	//!< holds value of standard return-cont. reg.
     Value_t	stdExnCont;	//!< holds value of standard exception-cont. reg.
     Addr_t	allocPtr;	//!< allocation pointer
+    uint64_t	*allocSiteCnts;	//!< per-site allocation counters (see alloc-prof.h)
 			      /* logging support */
 /* NOTE: these volatile annotations are not required for the SWP branch */
     volatile uint64_t
@@ -105,6 +124,9 @@ struct struct_vproc {
                                 //!< true when this vproc has been signaled that
 				//! global GC has started, but it has not
 				//! started yet.
+    volatile bool parked;	//!< true when the vproc is parked (see elastic.h);
+				//!  parked vprocs do not take part in global GC
+    bool	unparkReq;	//!< set (with the lock held) to unpark the vproc
 
   /* additional optional fields used for stats etc. */
     Timer_t	timer;		//!< tracks the execution time of this vproc
@@ -119,13 +141,14 @@ struct struct_vproc {
 				//!  global GCs.
     uint64_t	nBytesPromoted;	//!< the number of bytes promoted on this vproc
     Timer_t	promoteTimer;	//!< used to track time taken by promotions
+    uint32_t	nGCBarriers;	//!< number of global-GC barriers passed
+    Timer_t	gcBarrierTimer;	//!< time spent waiting at global-GC barriers
 #endif
 #ifndef ENABLE_LOGGING	      /* GC counters for logging info */
 
 #endif
 #ifdef ENABLE_PERF_COUNTERS
-    PerfCntrs_t misses;//!< L3 read miss perf counter
-    PerfCntrs_t reads;//!< L3 read perf counter
+    PerfCntrs_t	perf;		//!< hardware performance counters
 #endif
 };
 
@@ -134,7 +157,7 @@ typedef void (*VProcFn_t) (VProc_t *vp, void *arg);
 
 /* the array of vprocs */
 extern int		NumVProcs;
-extern int		*NumVProcsPerNode;
+extern int		*NumVProcsPerNode; //!< number of unparked vprocs per node
 extern int		*MinVProcPerNode;
 extern VProc_t		*VProcs[MAX_NUM_VPROCS];
 extern bool		ShutdownFlg;
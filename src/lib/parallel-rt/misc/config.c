@@ -210,7 +210,7 @@ Addr_t GetSizeConfig (const char *key, Addr_t dfltScale, Addr_t dflt)
 	    Error("bogus size for %s\n", key);
 	    return dflt;
 	}
-	return ((Addr_t)sz) * dfltScale;
+	return (Addr_t)sz;
     }
 
     return dflt;
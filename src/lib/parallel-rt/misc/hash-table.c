@@ -0,0 +1,291 @@
+/* hash-table.c
+ *
+ * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
+ * All rights reserved.
+ *
+ * A lock-free hash table from int keys to ML values.  The table uses open
+ * addressing with linear probing, and the slots are updated with CAS.  Entries
+ * are immutable (key, value) objects and are never removed, so a search can stop
+ * at the first empty slot.
+ *
+ * When an insertion has to probe too many slots, the table grows.  The thread
+ * that notices allocates a store twice as large and links it from the old one;
+ * after that, every thread that runs into the migration helps to finish it by
+ * claiming chunks of the old store and copying them.  A copied slot is marked
+ * MOVED, which stops any further updates of the slot in the old store.  Threads
+ * only use the new store once all of the chunks have been copied, so during a
+ * migration the new store is only written by the migrators, which own disjoint
+ * sets of keys.  An update that slips into an old slot before it is marked is not
+ * lost: the migrator's CAS of the slot fails, and it copies the slot again.
+ *
+ * All of the objects are in the global heap, so the GC traces them.  The empty
+ * and moved markers and the integers in the store headers are tagged, so the GC
+ * does not treat them as pointers.  Since there are no GC safe points in this
+ * code, the pointers into the table stay valid for the duration of a call.
+ */
+
+#include "manticore-rt.h"
+#include "vproc.h"
+#include "value.h"
+#include "heap.h"
+#include "atomic-ops.h"
+#include "spin-barrier.h"
+#include "hash-table.h"
+
+/* the table object is a one-element vector that points to the current store */
+#define TBL_STORE(tbl)	(((Value_t *)ValueToPtr(tbl))[0])
+
+/* a store is a vector with a small header followed by its segments */
+#define ST_CAPACITY	0		//!< tagged number of slots (a power of two)
+#define ST_NEXT		1		//!< the store that replaces this one, or M_NIL
+#define ST_CLAIMED	2		//!< tagged number of migration chunks claimed
+#define ST_COPIED	3		//!< tagged number of migration chunks copied
+#define ST_HDR_SZ	4
+
+#define SEG_BITS	16		//!< a segment fits easily in a heap chunk
+#define SEG_SZ		(1 << SEG_BITS)
+#define CHUNK_SZ	1024		//!< number of slots per migration chunk
+#define PROBE_LIMIT	32		//!< insertions that probe further grow the table
+#define MIN_CAPACITY	64
+#define MAX_CAPACITY	(1 << 30)
+
+#define EMPTY		M_NIL		//!< a slot that has never been used
+#define MOVED		((Value_t)3)	//!< a slot that has been copied to the next store
+
+/* an entry, which is allocated as a mixed object */
+typedef struct {
+    Value_t	value;
+    Word_t	key;
+} Entry_t;
+
+typedef enum { PUT_DONE, PUT_FAILED, PUT_MOVED, PUT_FULL } PutResult_t;
+
+STATIC_INLINE Value_t Tag (Word_t n)	{ return (Value_t)((n << 1) | 1); }
+STATIC_INLINE Word_t Untag (Value_t v)	{ return (Word_t)v >> 1; }
+
+STATIC_INLINE Value_t *StoreFields (Value_t st)	{ return (Value_t *)ValueToPtr(st); }
+STATIC_INLINE Word_t Capacity (Value_t st)	{ return Untag(StoreFields(st)[ST_CAPACITY]); }
+STATIC_INLINE Word_t NumChunks (Word_t cap)	{ return (cap + CHUNK_SZ - 1) / CHUNK_SZ; }
+
+STATIC_INLINE Word_t EntryKey (Value_t e)	{ return ((Entry_t *)ValueToPtr(e))->key; }
+
+STATIC_INLINE volatile Value_t *Slot (Value_t st, Word_t i)
+{
+    Value_t seg = StoreFields(st)[ST_HDR_SZ + (i >> SEG_BITS)];
+    return &(((volatile Value_t *)ValueToPtr(seg))[i & (SEG_SZ - 1)]);
+}
+
+/* Fibonacci hashing; we take the high half of the product, which is well mixed */
+STATIC_INLINE Word_t Hash (Word_t key)
+{
+    return (Word_t)((key * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+static Value_t NewStore (VProc_t *vp, Word_t cap)
+{
+    int nSegs = (cap + SEG_SZ - 1) / SEG_SZ;
+    int segSz = (cap < SEG_SZ) ? cap : SEG_SZ;
+    Value_t st = GlobalAllocPolyArray (vp, ST_HDR_SZ + nSegs, M_NIL);
+    Value_t *fields = StoreFields(st);
+
+    fields[ST_CAPACITY] = Tag(cap);
+    fields[ST_NEXT] = M_NIL;
+    fields[ST_CLAIMED] = Tag(0);
+    fields[ST_COPIED] = Tag(0);
+    for (int i = 0;  i < nSegs;  i++)
+	fields[ST_HDR_SZ + i] = GlobalAllocPolyArray (vp, segSz, EMPTY);
+
+    return st;
+}
+
+/* copy an entry into a store that is being filled by a migration */
+static void CopyEntry (Value_t st, Value_t e)
+{
+    Word_t mask = Capacity(st) - 1;
+    Word_t key = EntryKey(e);
+
+    for (Word_t i = Hash(key) & mask;  ;  i = (i + 1) & mask) {
+	volatile Value_t *slot = Slot(st, i);
+	Value_t s = *slot;
+	if (s == EMPTY) {
+	    s = CompareAndSwapValue (slot, EMPTY, e);
+	    if (s == EMPTY)
+		return;
+	}
+      /* the key can only be here if we copied an older entry for it */
+	if (EntryKey(s) == key) {
+	    AtomicWriteValue (slot, e);
+	    return;
+	}
+    }
+}
+
+static void MigrateSlot (Value_t st, Value_t next, Word_t i)
+{
+    volatile Value_t *slot = Slot(st, i);
+
+    while (true) {
+	Value_t s = *slot;
+	if (s == MOVED)
+	    return;
+	if (s != EMPTY)
+	    CopyEntry (next, s);
+	if (CompareAndSwapValue (slot, s, MOVED) == s)
+	    return;
+    }
+}
+
+/* help to copy st into its next store, wait for the copy to be complete, and
+ * return the next store.
+ */
+static Value_t FinishMigration (Value_t tbl, Value_t st)
+{
+    Value_t *fields = StoreFields(st);
+    Value_t next = fields[ST_NEXT];
+    Word_t cap = Capacity(st);
+    Word_t nChunks = NumChunks(cap);
+
+    assert (next != M_NIL);
+
+    while (true) {
+	Word_t c = Untag((Value_t)FetchAndAddU64 ((volatile uint64_t *)&(fields[ST_CLAIMED]), 2));
+	if (c >= nChunks)
+	    break;
+	Word_t hi = (c + 1) * CHUNK_SZ;
+	if (hi > cap) hi = cap;
+	for (Word_t i = c * CHUNK_SZ;  i < hi;  i++)
+	    MigrateSlot (st, next, i);
+	FetchAndAddU64 ((volatile uint64_t *)&(fields[ST_COPIED]), 2);
+    }
+
+  /* the remaining chunks are being copied by other threads */
+    while (Untag(((volatile Value_t *)fields)[ST_COPIED]) < nChunks)
+	SpinPause ();
+
+  /* only the first of these succeeds; it fails for a store that has already been
+   * replaced.
+   */
+    CompareAndSwapValue (&TBL_STORE(tbl), st, next);
+
+    return next;
+}
+
+static Value_t Grow (VProc_t *vp, Value_t tbl, Value_t st)
+{
+    Value_t *fields = StoreFields(st);
+
+    if (fields[ST_NEXT] == M_NIL) {
+	Word_t cap = Capacity(st);
+	if (cap >= MAX_CAPACITY)
+	    Die ("hash table is full");
+      /* if we lose the race to install the new store, it is garbage */
+	CompareAndSwapValue (&(fields[ST_NEXT]), M_NIL, NewStore (vp, 2 * cap));
+    }
+
+    return FinishMigration (tbl, st);
+}
+
+/* store the entry e for key in st.  If check is true, then the entry is only
+ * stored if the key's current entry is old (M_NIL meaning none).
+ */
+static PutResult_t Put (Value_t st, Word_t key, bool check, Value_t old, Value_t e)
+{
+    Word_t mask = Capacity(st) - 1;
+    Word_t h = Hash(key);
+    Word_t limit = (PROBE_LIMIT < mask) ? PROBE_LIMIT : mask;
+
+    for (Word_t n = 0;  n <= limit;  n++) {
+	volatile Value_t *slot = Slot(st, (h + n) & mask);
+	Value_t s = *slot;
+	while (true) {
+	    if (s == MOVED)
+		return PUT_MOVED;
+	    if ((s != EMPTY) && (EntryKey(s) != key))
+		break;
+	    if (check && (s != old))
+		return PUT_FAILED;
+	    Value_t s2 = CompareAndSwapValue (slot, s, e);
+	    if (s2 == s)
+		return PUT_DONE;
+	  /* somebody else changed the slot, so look at it again */
+	    s = s2;
+	}
+    }
+
+    return PUT_FULL;
+}
+
+static int32_t Update (VProc_t *vp, Value_t tbl, int32_t key, bool check, Value_t old, Value_t v)
+{
+    Word_t k = (Word_t)(uint32_t)key;
+    Value_t e = GlobalAllocNonUniform (vp, 2, PTR(v), INT(k));
+    Value_t st = TBL_STORE(tbl);
+
+    while (true) {
+	switch (Put (st, k, check, old, e)) {
+	  case PUT_DONE:
+	    return 1;
+	  case PUT_FAILED:
+	    return 0;
+	  case PUT_MOVED:
+	    st = FinishMigration (tbl, st);
+	    break;
+	  case PUT_FULL:
+	    st = Grow (vp, tbl, st);
+	    break;
+	}
+    }
+}
+
+Value_t M_HashTableNew (VProc_t *vp, int32_t sizeHint)
+{
+    Word_t cap = MIN_CAPACITY;
+
+    while ((cap < 2 * (Word_t)sizeHint) && (cap < MAX_CAPACITY))
+	cap *= 2;
+
+    Value_t st = NewStore (vp, cap);
+
+    return GlobalAllocPolyArray (vp, 1, st);
+}
+
+Value_t M_HashTableFindEntry (Value_t tbl, int32_t key)
+{
+    Word_t k = (Word_t)(uint32_t)key;
+    Value_t st = TBL_STORE(tbl);
+
+  retry:
+    {
+	Word_t mask = Capacity(st) - 1;
+	Word_t h = Hash(k);
+	for (Word_t n = 0;  n <= mask;  n++) {
+	    Value_t s = *Slot(st, (h + n) & mask);
+	    if (s == EMPTY)
+		return M_NIL;
+	    else if (s == MOVED) {
+	      /* the entry may already be in the next store */
+		st = FinishMigration (tbl, st);
+		goto retry;
+	    }
+	    else if (EntryKey(s) == k)
+		return s;
+	}
+    }
+
+    return M_NIL;
+}
+
+void M_HashTableInsert (VProc_t *vp, Value_t tbl, int32_t key, Value_t v)
+{
+    Update (vp, tbl, key, false, M_NIL, v);
+}
+
+int32_t M_HashTableCompareAndSet (VProc_t *vp, Value_t tbl, int32_t key, Value_t old, Value_t v)
+{
+    return Update (vp, tbl, key, true, old, v);
+}
+
+int32_t M_HashTableCapacity (Value_t tbl)
+{
+    return (int32_t)Capacity(TBL_STORE(tbl));
+}
@@ -19,9 +19,153 @@
 #include "inline-log.h"
 #include "os-threads.h"
 #include "vproc.h"
+#include "atomic-ops.h"
 
 static int	LogFD = -1;
 
+/* The block index that is appended to the log file (see log-file.h).  Blocks are
+ * written with pwrite at offsets reserved from LogOffset, so that we know where
+ * each block lands without serializing the writers.  Each vproc only appends to
+ * its own index array, so the arrays do not need locking.
+ */
+static volatile uint64_t	LogOffset;			// next free offset in the file
+static LogIndexEntry_t		*LogIndex[MAX_NUM_VPROCS];	// per-vproc block index
+static uint32_t			LogIndexLen[MAX_NUM_VPROCS];	// number of entries in use
+static uint32_t			LogIndexSz[MAX_NUM_VPROCS];	// allocated size of LogIndex[i]
+
+/* InitLogIndex:
+ *
+ * Reset the block index for a new log file.
+ */
+void InitLogIndex ()
+{
+    LogOffset = 0;
+    for (int i = 0;  i < MAX_NUM_VPROCS;  i++) {
+	if (LogIndex[i] != 0) {
+	    FREE (LogIndex[i]);
+	    LogIndex[i] = 0;
+	}
+	LogIndexLen[i] = 0;
+	LogIndexSz[i] = 0;
+    }
+}
+
+/* WriteLogBlock:
+ *
+ * Write szB bytes of data at the end of the log file and return the file offset
+ * where they were written.
+ */
+uint64_t WriteLogBlock (int fd, const void *data, uint32_t szB)
+{
+    uint64_t offset = FetchAndAddU64 (&LogOffset, szB);
+    const char *p = (const char *)data;
+    uint64_t off = offset;
+    uint32_t remaining = szB;
+
+    while (remaining > 0) {
+	ssize_t nb = pwrite (fd, p, remaining, off);
+	if (nb < 0) {
+	    if (errno == EINTR)
+		continue;
+	    Error("Failure writing log data; errno = %d\n", errno);
+	    break;
+	}
+	p += nb;
+	off += nb;
+	remaining -= nb;
+    }
+
+    return offset;
+
+}
+
+/* IndexLogBlock:
+ *
+ * Add an entry for a block of events owned by the given vproc to the index.
+ * Blocks must be added in time order.
+ */
+void IndexLogBlock (uint32_t vpId, uint64_t offset, uint32_t szB, uint64_t firstTS, uint64_t lastTS)
+{
+    assert (vpId < MAX_NUM_VPROCS);
+
+    if (LogIndexLen[vpId] == LogIndexSz[vpId]) {
+	uint32_t newSz = (LogIndexSz[vpId] == 0) ? 64 : 2 * LogIndexSz[vpId];
+	LogIndexEntry_t *newIndex = REALLOC(LogIndex[vpId], newSz * sizeof(LogIndexEntry_t));
+	if (newIndex == 0)
+	    Die ("unable to grow log index");
+	LogIndex[vpId] = newIndex;
+	LogIndexSz[vpId] = newSz;
+    }
+
+    LogIndexEntry_t *ent = &(LogIndex[vpId][LogIndexLen[vpId]++]);
+    ent->offset = offset;
+    ent->firstTS = firstTS;
+    ent->lastTS = lastTS;
+    ent->szB = szB;
+    ent->vpId = vpId;
+
+}
+
+/* WriteLogIndex:
+ *
+ * Append the block index and its footer to the log file.  This function should
+ * only be called once all of the blocks have been written.
+ */
+void WriteLogIndex (int fd, uint32_t nVProcs)
+{
+    LogIndexFooter_t footer;
+
+    footer.indexOffset = LogOffset;
+    footer.nEntries = 0;
+    footer.nVProcs = nVProcs;
+    footer.magic = LOG_INDEX_MAGIC;
+
+    for (int i = 0;  i < MAX_NUM_VPROCS;  i++) {
+	if (LogIndexLen[i] > 0) {
+	    WriteLogBlock (fd, LogIndex[i], LogIndexLen[i] * sizeof(LogIndexEntry_t));
+	    footer.nEntries += LogIndexLen[i];
+	}
+    }
+
+    WriteLogBlock (fd, &footer, sizeof(footer));
+
+}
+
+/* LogTSToNS:
+ *
+ * Convert a log timestamp to nanoseconds.
+ */
+STATIC_INLINE uint64_t LogTSToNS (LogTS_t *ts)
+{
+#if HAVE_MACH_ABSOLUTE_TIME
+    return ts->ts_mach;
+#elif HAVE_CLOCK_GETTIME
+    return (uint64_t)ts->ts_val.sec * 1000000000 + (uint64_t)ts->ts_val.frac;
+#else
+    return (uint64_t)ts->ts_val.sec * 1000000000 + (uint64_t)ts->ts_val.frac * 1000;
+#endif
+}
+
+/* WriteLogBuffer:
+ *
+ * Write a vproc's log buffer to the log file and record it in the index.
+ */
+static void WriteLogBuffer (LogBuffer_t *buf)
+{
+    uint64_t offset = WriteLogBlock (LogFD, buf, LOGBLOCK_SZB);
+
+  /* when a full buffer is flushed, next has already been incremented past the end
+   * of the buffer (see NextLogEvent).
+   */
+    int n = (buf->next < (int)LOGBUF_SZ) ? buf->next : (int)LOGBUF_SZ;
+    if (n > 0) {
+	IndexLogBlock (buf->vpId, offset, LOGBLOCK_SZB,
+	    LogTSToNS(&(buf->log[0].timestamp)),
+	    LogTSToNS(&(buf->log[n-1].timestamp)));
+    }
+
+}
+
 
 /* InitLogFile:
  *
@@ -35,9 +179,10 @@ void InitLogFile (const char *name, int nvps, int ncpus)
     } hdrBuf;
     LogFileHeader_t *hdr = &hdrBuf._hdr;
 
-    if ((LogFD = open(name, O_TRUNC|O_CREAT|O_WRONLY|O_APPEND, 0664)) < 0) {
+    if ((LogFD = open(name, O_TRUNC|O_CREAT|O_WRONLY, 0664)) < 0) {
 	Die ("unable to open log file: %s", strerror(errno));
     }
+    InitLogIndex ();
 
   /* initialize the header */
     bzero(&hdrBuf, LOGBLOCK_SZB);
@@ -70,8 +215,9 @@ void InitLogFile (const char *name, int nvps, int ncpus)
     hdr->nCPUs		= ncpus;
 
   /* write the header block */
-    if (write(LogFD, hdr, LOGBLOCK_SZB) < 0)
+    if (pwrite(LogFD, hdr, LOGBLOCK_SZB, 0) < 0)
 	Die("Error writing logfile header\n");
+    LogOffset = LOGBLOCK_SZB;
 
 }
 
@@ -106,14 +252,7 @@ void SwapLogBuffers (VProc_t *vp, LogBuffer_t *curBuf)
     vp->log->seqNum = curBuf->seqNum+1;
 
   // write the buffer to a file
-    ssize_t nb;
-    do {
-	nb = write (LogFD, curBuf, LOGBLOCK_SZB);
-	if ((nb < 0) && (errno != EINTR)) {
-	    Error("Failure writing log data; errno = %d\n", errno);
-	    break;
-	}
-    } while (nb < 0);
+    WriteLogBuffer (curBuf);
 
   // reset curBuf's next pointer for its next use
     curBuf->next = 0;
@@ -131,11 +270,14 @@ void FinishLog ()
     for (int i = 0;  i < NumVProcs;  i++) {
 	VProc_t *vp = VProcs[i];
 	if (vp->log->next != 0) {
-	    int ignored = write (LogFD, (const void*)vp->log, LOGBLOCK_SZB);
+	    WriteLogBuffer ((LogBuffer_t *)vp->log);
 	    vp->log->next = 0;
 	}
     }
 
+  /* append the block index */
+    WriteLogIndex (LogFD, NumVProcs);
+
   /* close the file */
     close (LogFD);
     LogFD = -1;
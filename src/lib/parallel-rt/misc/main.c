@@ -15,12 +15,20 @@
 #include "vproc.h"
 #include "heap.h"
 #include "os-threads.h"
+#include "metrics.h"
+#include "perf.h"
+#include "profile.h"
+#include "alloc-prof.h"
+#include "preempt.h"
+#include "elastic.h"
+#include "vector-kernels.h"
 #include "asm-offsets.h" /* for RUNTIME_MAGIC */
 
 static void PingLoop ();
 static void Ping (int n);
 #ifndef HAVE_SIGTIMEDWAIT
 static void SigHandler (int sig, siginfo_t *si, void *uc);
+static volatile sig_atomic_t MetricsRequested = false;
 #endif
 
 #define MIN_TIMEQ_NS	1000000		/* minimum timeq in nanoseconds (== 1ms) */
@@ -42,6 +50,9 @@ options:\n\
   -d             Enable debugging output\n\
   -q n           Default time quantum (in milliseconds)\n\
   -perf typ      Generate a performance log of the specified type\n\
+  -perf-events[=e] Count the comma-separated perf events e (e.g., cycles,\n\
+                 instructions,llc-misses,dtlb-misses,branch-misses, or rNNNN\n\
+                 for a raw hex event code); implies -perf\n\
   -gcstats typ   Generate garbage collection statics in specified type\n\
   -gcstatsfile f Write gcstats output to a non-default file name\n\
   -config file   Use an alternative runtime-system configuration file\n\
@@ -49,8 +60,27 @@ options:\n\
   -dense         Allocate vprocs on the same package first\n\
   -log [f]       Write log events, optionally to file f\n\
   -nursery size  Set GC nursery size (debug build only)\n\
+  -maxheap size  Limit the total heap memory to size (default MB); the program\n\
+                 fails with a heap report if its live data does not fit\n\
   -gcdebug       Enable GC debugging output (debug build only)\n\
   -heapcheck typ Turn on additional heap property checking\n\
+  -census[=f]    Write a census of the live heap objects by type to file f\n\
+                 (default census.out) after each global GC\n\
+  -metrics[=f]   Write a JSON snapshot of the runtime counters to file f\n\
+                 (default metrics.json) whenever SIGUSR1 is received\n\
+  -metricsperiod n  Also write the metrics snapshot every n milliseconds\n\
+  -prof[=f]      Write a statistical profile to file f (default prof.out)\n\
+  -profrate n    Take n profile samples per second of CPU time (default 1000)\n\
+  -allocprof[=f] Write the allocation-site profile to file f (default\n\
+                 allocprof.out); requires a program compiled with -allocprof\n\
+  -preempt m     Select the source of timer preemption (m is one of \"timer\",\n\
+                 \"ping\", or \"none\"; the default is \"timer\" on Linux)\n\
+  -ws-nopreempt  Do not timer preempt vprocs that run work-stealing workers\n\
+  -preemptstats  Report the per-vproc preemption timer jitter at exit\n\
+  -elastic       Park idle vprocs and unpark them when the load grows\n\
+  -parkafter n   Park a vproc that is idle for most of an n millisecond\n\
+                 window (default 100)\n\
+  -novec         Use the scalar versions of the int and double leaf kernels\n\
   -h             Print this information\n\
   -?             Print this information\n\
 \n\
@@ -71,6 +101,7 @@ file:  Path to a file of \"name = value\" pairs:\n\
   MAJOR_GC_THRESHOLD=size\n\
   BASE_GLOBAL_HEAP_SZB=size\n\
   PER_VPROC_HEAP_SZB=size\n\
+  MAX_HEAP_SZB=size\n\
 \n\
 procs:\n\
   Comma-separated list of numbers corresponding to procesors for\n\
@@ -112,11 +143,18 @@ int main (int argc, const char **argv)
     }
 
     DiscoverTopology ();
-    HeapInit (opts);
-    VProcInit ((bool)SequentialFlag, opts);
+    InitMetrics (opts);
+    InitProfiler (opts);
+    InitAllocProf (opts);
+    InitPreemption (opts, TimeQ);
+    InitElastic (opts, TimeQ);
+    InitVectorKernels (opts);
 #if defined(ENABLE_PERF_COUNTERS) && defined(TARGET_LINUX)
+  /* the perf options must be processed before the vprocs open their counters */
     ParsePerfOptions (opts);
 #endif
+    HeapInit (opts);
+    VProcInit ((bool)SequentialFlag, opts);
 
     PingLoop();
 
@@ -144,6 +182,17 @@ static void PingLoop ()
     }
     tq.tv_nsec = nsec / NumVProcs;
 
+  /* when the vprocs have their own preemption timers, this loop only needs to
+   * wake up for the periodic metrics snapshots.
+   */
+    if (PreemptMode != PREEMPT_PING) {
+	tq.tv_sec = ns / 1000000000;
+	tq.tv_nsec = ns % 1000000000;
+    }
+
+  /* time of the next periodic metrics snapshot */
+    uint64_t nextMetrics = TIMER_Now() + (uint64_t)MetricsPeriod * 1000000;
+
 #if defined(HAVE_SIGTIMEDWAIT)
     sigset_t		sigs;
     siginfo_t		info;
@@ -152,6 +201,8 @@ static void PingLoop ()
     sigaddset (&sigs, SIGHUP);
     sigaddset (&sigs, SIGINT);
     sigaddset (&sigs, SIGQUIT);
+    if (MetricsFlg)
+	sigaddset (&sigs, SIGUSR1);
 #else
     // setup signal handler
     struct sigaction sa;
@@ -161,6 +212,8 @@ static void PingLoop ()
     sigaction (SIGHUP, &sa, 0);
     sigaction (SIGINT, &sa, 0);
     sigaction (SIGQUIT, &sa, 0);
+    if (MetricsFlg)
+	sigaction (SIGUSR1, &sa, 0);
 #endif
 
     while (true) {
@@ -168,7 +221,13 @@ static void PingLoop ()
 	int sigNum = sigtimedwait (&sigs, &info, &tq);
 	if (sigNum < 0) {
 	  // timeout
-	    Ping (nPings);
+	    if (PreemptMode == PREEMPT_PING)
+		Ping (nPings);
+	    ElasticTick ();
+	}
+	else if (info.si_signo == SIGUSR1) {
+	  // request for a metrics snapshot
+	    WriteMetrics ();
 	}
 	else {
 	  // signal
@@ -181,9 +240,19 @@ static void PingLoop ()
 	}
 	else {
 	  // timeout
-	    Ping (nPings);
+	    if (PreemptMode == PREEMPT_PING)
+		Ping (nPings);
+	    ElasticTick ();
+	}
+	if (MetricsRequested) {
+	    MetricsRequested = false;
+	    WriteMetrics ();
 	}
 #endif
+	if ((MetricsPeriod > 0) && (TIMER_Now() >= nextMetrics)) {
+	    WriteMetrics ();
+	    nextMetrics = TIMER_Now() + (uint64_t)MetricsPeriod * 1000000;
+	}
     }
 
 } /* end of PingLoop */
@@ -204,6 +273,11 @@ static void Ping (int n)
 #ifndef HAVE_SIGTIMEDWAIT
 static void SigHandler (int sig, siginfo_t *si, void *_uc)
 {
+    if (sig == SIGUSR1) {
+      // defer the snapshot to the PingLoop, since it is not async-signal safe
+	MetricsRequested = true;
+	return;
+    }
     Error("Received signal %d\n", sig);
     exit (0);
 }
@@ -0,0 +1,141 @@
+/* metrics.c
+ *
+ * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
+ * All rights reserved.
+ *
+ * Live snapshots of the runtime's per-vproc counters in JSON format.  The counters
+ * are read without stopping the mutators; since they only increase, each value in
+ * a snapshot is accurate as of some point during the time the snapshot was taken.
+ * A snapshot is written to a temporary file that is then renamed, so readers of
+ * the metrics file never see a partial snapshot.
+ */
+
+#include "manticore-rt.h"
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <inttypes.h>
+#include "options.h"
+#include "value.h"
+#include "vproc.h"
+#include "heap.h"
+#include "metrics.h"
+#ifdef ENABLE_PERF_COUNTERS
+#include "perf.h"
+#endif
+
+#define DFLT_METRICS_FILE	"metrics.json"
+
+bool		MetricsFlg = false;
+int		MetricsPeriod = 0;
+static const char *MetricsFile;		// the name of the metrics file
+static char	*MetricsTmpFile;	// the name of the file used to build a snapshot
+static uint64_t	StartTime;		// time at which the runtime started (in ns)
+
+void InitMetrics (Options_t *opts)
+{
+  /* NOTE: GetStringEqOpt matches prefixes, so we have to check for -metricsperiod first */
+    MetricsPeriod = GetIntOpt (opts, "-metricsperiod", 0);
+    MetricsFile = GetStringEqOpt (opts, "-metrics", DFLT_METRICS_FILE);
+
+    if (MetricsFile == 0)
+	return;
+
+    MetricsFlg = true;
+    if (MetricsPeriod < 0)
+	MetricsPeriod = 0;
+    MetricsTmpFile = NEWVEC(char, strlen(MetricsFile) + 5);
+    strcpy (MetricsTmpFile, MetricsFile);
+    strcat (MetricsTmpFile, ".tmp");
+    StartTime = TIMER_Now ();
+
+#if defined(HAVE_SIGTIMEDWAIT)
+  /* block SIGUSR1, so that the PingLoop can wait for it; the vproc threads
+   * inherit this mask.
+   */
+    sigset_t sigs;
+    sigemptyset (&sigs);
+    sigaddset (&sigs, SIGUSR1);
+    pthread_sigmask (SIG_BLOCK, &sigs, 0);
+#endif
+
+}
+
+#ifndef NO_GC_STATS
+static void WriteGCCntrs (FILE *f, const char *name, GCCntrs_t *cntrs, int num)
+{
+    fprintf (f,
+	"      \"%s\": {\"num\": %d, \"alloc\": %" PRIu64 ", \"collected\": %" PRIu64
+	", \"copied\": %" PRIu64 ", \"time\": %f},\n",
+	name, num, cntrs->nBytesAlloc, cntrs->nBytesCollected, cntrs->nBytesCopied,
+	TIMER_GetTime (&(cntrs->timer)));
+}
+#endif
+
+#ifdef ENABLE_PERF_COUNTERS
+static void WritePerfCntrs (FILE *f, PerfCntrs_t *cntrs)
+{
+    fprintf (f, "      \"perf\": {");
+    for (int e = 0;  e < cntrs->nEvents;  e++) {
+	fprintf (f, "%s\"%s\": {", (e > 0) ? ", " : "", PerfEventName(e));
+	for (int ph = 0;  ph < NUM_PERF_PHASES;  ph++) {
+	    fprintf (f, "%s\"%s\": %" PRIu64, (ph > 0) ? ", " : "",
+		PerfPhaseName(ph), cntrs->counts[ph][e]);
+	}
+	fprintf (f, "}");
+    }
+    fprintf (f, "},\n");
+}
+#endif
+
+void WriteMetrics ()
+{
+    if (! MetricsFlg)
+	return;
+
+    FILE *f = fopen (MetricsTmpFile, "w");
+    if (f == 0) {
+	Error ("unable to open metrics file \"%s\"\n", MetricsTmpFile);
+	return;
+    }
+
+    uint64_t now = TIMER_Now ();
+    fprintf (f, "{\n");
+    fprintf (f, "  \"time\": %f,\n", 1.0e-9 * (double)(now - StartTime));
+    fprintf (f, "  \"nVProcs\": %d,\n", NumVProcs);
+    fprintf (f, "  \"nGlobalGCs\": %d,\n", NumGlobalGCs);
+    fprintf (f, "  \"vprocs\": [\n");
+    for (int i = 0;  i < NumVProcs;  i++) {
+	VProc_t *vp = VProcs[i];
+	fprintf (f, "    {\n");
+	fprintf (f, "      \"id\": %d,\n", vp->id);
+#ifndef NO_GC_STATS
+      // the minor-GC allocation count only includes completed nurseries, so add
+      // the bytes that have been allocated since the last minor GC.
+	GCCntrs_t minor = vp->minorStats;
+	minor.nBytesAlloc += vp->allocPtr - vp->nurseryBase - WORD_SZB;
+	WriteGCCntrs (f, "minor", &minor, vp->nMinorGCs);
+	WriteGCCntrs (f, "major", &(vp->majorStats), vp->nMajorGCs);
+	WriteGCCntrs (f, "global", &(vp->globalStats), NumGlobalGCs);
+	fprintf (f,
+	    "      \"promotion\": {\"num\": %d, \"bytes\": %" PRIu64 ", \"time\": %f},\n",
+	    vp->nPromotes, vp->nBytesPromoted, TIMER_GetTime (&(vp->promoteTimer)));
+#endif
+#ifdef ENABLE_PERF_COUNTERS
+	WritePerfCntrs (f, &(vp->perf));
+#endif
+	fprintf (f, "      \"sleeping\": %s\n", (vp->sleeping == M_TRUE) ? "true" : "false");
+	fprintf (f, "    }%s\n", (i+1 < NumVProcs) ? "," : "");
+    }
+    fprintf (f, "  ]\n");
+    fprintf (f, "}\n");
+
+    if (fclose (f) != 0) {
+	Error ("error writing metrics file \"%s\"\n", MetricsTmpFile);
+	return;
+    }
+    if (rename (MetricsTmpFile, MetricsFile) < 0) {
+	Error ("unable to rename metrics file to \"%s\"\n", MetricsFile);
+    }
+
+}
@@ -221,7 +221,7 @@ Addr_t GetSizeOpt (Options_t *opts, const char *opt, Addr_t dfltScale, Addr_t df
 			opts->cmd, opt);
 		    return dflt;
 		}
-		return ((Addr_t)sz) * dfltScale;
+		return (Addr_t)sz;
 	    }
 	    else {
 		CompressOpts (opts, i-1, 1);
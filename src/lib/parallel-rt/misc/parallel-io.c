@@ -0,0 +1,429 @@
+/* parallel-io.c
+ *
+ * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
+ * All rights reserved.
+ *
+ * Memory-mapped input files for the ParallelIO structure.  The ML code splits a
+ * file into byte ranges at line boundaries and parses the ranges in parallel,
+ * so these functions only look at the range that they are given.  The functions
+ * that fill sequences do not allocate, so the sequence pointers that they are
+ * given stay valid.
+ *
+ * This file also implements rope files, which hold the leaves of a rope in a
+ * binary format.  A rope file has a header, followed by an index with an entry
+ * for each leaf, followed by the leaves' data:
+ *
+ *	header		magic, version, element kind, # of leaves, # of elements
+ *	index		for each leaf: offset of its data, # of elements
+ *	data		for each leaf: the leaf's columns, one after the other
+ *
+ * The writer knows where each leaf goes from its index and the number of
+ * elements that precede it, so the leaves are written in parallel with pwrite.
+ * The reader maps the file and reads the leaves in parallel.  Numbers are
+ * in the native byte order.
+ */
+
+#include "manticore-rt.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "vproc.h"
+#include "value.h"
+#include "heap.h"
+#include "parallel-io.h"
+
+#define MAX_LOCAL_STRING_SZB	1024	//!< longer strings are allocated in the global heap
+#define MAX_NUMBER_LEN		64	//!< longer fields are not numbers
+
+typedef struct {
+    const char	*data;		//!< the file's contents (0 for an empty file)
+    int64_t	len;		//!< the file's size in bytes
+} MappedFile_t;
+
+#define ROPE_FILE_MAGIC		"MCROPE\0\0"
+#define ROPE_FILE_VERSION	1
+
+typedef struct {
+    char	magic[8];
+    uint32_t	version;
+    uint32_t	kind;		//!< the element kind (see parallel-io.h)
+    uint64_t	nLeaves;
+    uint64_t	nElems;
+} RopeFileHdr_t;
+
+typedef struct {
+    uint64_t	offset;		//!< file offset of the leaf's data
+    uint64_t	nElems;		//!< number of elements in the leaf
+} RopeFileLeaf_t;
+
+typedef struct {
+    int		fd;
+    uint32_t	kind;
+    int64_t	nLeaves;
+} RopeFile_t;
+
+/* the sizes of the columns for each element kind */
+static const int ColSzB[][2] = {
+	[ROPE_FILE_INT]			= { sizeof(int32_t), 0 },
+	[ROPE_FILE_DOUBLE]		= { sizeof(double), 0 },
+	[ROPE_FILE_INT_DOUBLE]		= { sizeof(int32_t), sizeof(double) },
+	[ROPE_FILE_DOUBLE_DOUBLE]	= { sizeof(double), sizeof(double) },
+    };
+
+STATIC_INLINE bool ValidKind (int32_t kind)
+{
+    return (ROPE_FILE_INT <= kind) && (kind <= ROPE_FILE_DOUBLE_DOUBLE);
+}
+
+STATIC_INLINE int EltSzB (int32_t kind)
+{
+    return ColSzB[kind][0] + ColSzB[kind][1];
+}
+
+/* return the file offset of the first leaf's data */
+STATIC_INLINE int64_t DataStart (int64_t nLeaves)
+{
+    return sizeof(RopeFileHdr_t) + nLeaves * sizeof(RopeFileLeaf_t);
+}
+
+STATIC_INLINE bool IsSep (char c)
+{
+    return (c == ',') || (c == ' ') || (c == '\n') || (c == '\t') || (c == '\r')
+	|| (c == '\f') || (c == '\v');
+}
+
+/* return the offset of the first field separator at or after p */
+STATIC_INLINE int64_t FieldEnd (const char *data, int64_t p, int64_t hi)
+{
+    while ((p < hi) && !IsSep(data[p]))
+	p++;
+    return p;
+}
+
+/* return the offset of the first field at or after p */
+STATIC_INLINE int64_t SkipSeps (const char *data, int64_t p, int64_t hi)
+{
+    while ((p < hi) && IsSep(data[p]))
+	p++;
+    return p;
+}
+
+void *M_MapFileIn (Value_t filename)
+{
+    SequenceHdr_t	*filenameS = (SequenceHdr_t *)ValueToPtr(filename);
+    struct stat		st;
+
+    int fd = open ((char *)(filenameS->data), O_RDONLY);
+    if (fd < 0)
+	return 0;
+    if (fstat (fd, &st) < 0) {
+	close (fd);
+	return 0;
+    }
+
+    MappedFile_t *mf = NEW(MappedFile_t);
+    mf->len = st.st_size;
+    mf->data = 0;
+    if (mf->len > 0) {
+	void *p = mmap (0, mf->len, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (p == MAP_FAILED) {
+	    close (fd);
+	    FREE (mf);
+	    return 0;
+	}
+      /* we expect to read all of the file soon */
+	madvise (p, mf->len, MADV_WILLNEED);
+	mf->data = (const char *)p;
+    }
+
+  /* the mapping stays valid after the file is closed */
+    close (fd);
+
+    return mf;
+}
+
+void M_UnmapFile (void *mf)
+{
+    MappedFile_t *f = (MappedFile_t *)mf;
+
+    if (f == 0)
+	return;
+    if (f->data != 0)
+	munmap ((void *)(f->data), f->len);
+    FREE (f);
+}
+
+int64_t M_MappedFileSize (void *mf)
+{
+    if (mf == 0)
+	return -1;
+    return ((MappedFile_t *)mf)->len;
+}
+
+int64_t M_MappedRecordStart (void *mf, int64_t pos)
+{
+    MappedFile_t *f = (MappedFile_t *)mf;
+
+    if (pos <= 0)
+	return 0;
+    else if (pos >= f->len)
+	return f->len;
+    else if (f->data[pos-1] == '\n')
+	return pos;
+    else {
+	const char *nl = memchr (f->data + pos, '\n', f->len - pos);
+	return (nl == 0) ? f->len : (nl - f->data) + 1;
+    }
+}
+
+int64_t M_MappedLineEnd (void *mf, int64_t pos, int64_t hi)
+{
+    MappedFile_t *f = (MappedFile_t *)mf;
+
+    if (pos >= hi)
+	return hi;
+    else {
+	const char *nl = memchr (f->data + pos, '\n', hi - pos);
+	return (nl == 0) ? hi : nl - f->data;
+    }
+}
+
+int32_t M_MappedCountFields (void *mf, int64_t lo, int64_t hi)
+{
+    const char *data = ((MappedFile_t *)mf)->data;
+    int32_t n = 0;
+
+    for (int64_t p = SkipSeps (data, lo, hi);  p < hi;  p = SkipSeps (data, p, hi)) {
+	n++;
+	p = FieldEnd (data, p, hi);
+    }
+
+    return n;
+}
+
+int64_t M_MappedParseInts (void *mf, int64_t pos, int64_t hi, int32_t *dst, int32_t n)
+{
+    const char *data = ((MappedFile_t *)mf)->data;
+    int64_t p = pos;
+
+    for (int32_t i = 0;  i < n;  i++) {
+	p = SkipSeps (data, p, hi);
+	int64_t end = FieldEnd (data, p, hi);
+	bool neg = false;
+	if ((p < end) && ((data[p] == '-') || (data[p] == '~') || (data[p] == '+'))) {
+	    neg = (data[p] != '+');
+	    p++;
+	}
+	if (p == end)
+	    return -1;
+      /* int arithmetic wraps around on overflow */
+	uint32_t v = 0;
+	for (;  p < end;  p++) {
+	    unsigned int d = (unsigned char)data[p] - '0';
+	    if (d > 9)
+		return -1;
+	    v = 10 * v + d;
+	}
+	dst[i] = (int32_t)(neg ? -v : v);
+    }
+
+    return p;
+}
+
+int64_t M_MappedParseDoubles (void *mf, int64_t pos, int64_t hi, double *dst, int32_t n)
+{
+    const char *data = ((MappedFile_t *)mf)->data;
+    char buf[MAX_NUMBER_LEN + 1];
+    int64_t p = pos;
+
+    for (int32_t i = 0;  i < n;  i++) {
+	p = SkipSeps (data, p, hi);
+	int64_t end = FieldEnd (data, p, hi);
+	int len = end - p;
+	if ((len == 0) || (len > MAX_NUMBER_LEN))
+	    return -1;
+      /* the mapped data is not null terminated, so we copy the field for strtod */
+	memcpy (buf, data + p, len);
+	buf[len] = '\0';
+	if (buf[0] == '~')	/* SML-style negation */
+	    buf[0] = '-';
+	char *stop;
+	dst[i] = strtod (buf, &stop);
+	if (stop != buf + len)
+	    return -1;
+	p = end;
+    }
+
+    return p;
+}
+
+void M_MappedReadInts (void *mf, int64_t off, int32_t *dst, int32_t n)
+{
+    memcpy (dst, ((MappedFile_t *)mf)->data + off, n * sizeof(int32_t));
+}
+
+void M_MappedReadDoubles (void *mf, int64_t off, double *dst, int32_t n)
+{
+    memcpy (dst, ((MappedFile_t *)mf)->data + off, n * sizeof(double));
+}
+
+Value_t M_MappedLine (VProc_t *vp, void *mf, int64_t lo, int64_t hi)
+{
+    const char *data = ((MappedFile_t *)mf)->data;
+    int64_t len = hi - lo;
+
+  /* drop the carriage return of a DOS-style line ending */
+    if ((len > 0) && (data[hi-1] == '\r'))
+	len--;
+
+    if (len + 1 <= MAX_LOCAL_STRING_SZB) {
+	Value_t obj = AllocRaw (vp, len + 1);
+	memcpy (ValueToPtr(obj), data + lo, len);
+	((char *)ValueToPtr(obj))[len] = '\0';
+	return AllocNonUniform (vp, 2, PTR(obj), INT(len));
+    }
+    else {
+	if (len + 1 >= HEAP_CHUNK_SZB - WORD_SZB)
+	    Die ("line too long for ParallelIO");
+	Value_t obj = GlobalAllocRawArray (vp, len + 1, 1);
+	memcpy (ValueToPtr(obj), data + lo, len);
+	((char *)ValueToPtr(obj))[len] = '\0';
+	return GlobalAllocNonUniform (vp, 2, PTR(obj), INT(len));
+    }
+}
+
+/***** Rope files *****/
+
+/* write n bytes at the given offset, retrying on short writes */
+static bool WriteAll (int fd, const void *buf, size_t n, off_t off)
+{
+    const char *p = (const char *)buf;
+
+    while (n > 0) {
+	ssize_t nb = pwrite (fd, p, n, off);
+	if (nb < 0) {
+	    if (errno == EINTR)
+		continue;
+	    return false;
+	}
+	p += nb;
+	off += nb;
+	n -= nb;
+    }
+
+    return true;
+}
+
+void *M_RopeFileCreate (Value_t filename, int32_t kind, int64_t nLeaves, int64_t nElems)
+{
+    SequenceHdr_t	*filenameS = (SequenceHdr_t *)ValueToPtr(filename);
+    RopeFileHdr_t	hdr;
+
+    if (!ValidKind(kind))
+	return 0;
+
+    int fd = open ((char *)(filenameS->data), O_WRONLY|O_CREAT|O_TRUNC, 0666);
+    if (fd < 0)
+	return 0;
+
+    memcpy (hdr.magic, ROPE_FILE_MAGIC, sizeof(hdr.magic));
+    hdr.version = ROPE_FILE_VERSION;
+    hdr.kind = kind;
+    hdr.nLeaves = nLeaves;
+    hdr.nElems = nElems;
+
+  /* give the file its final size, so that the leaves can be written in any order */
+    if (!WriteAll (fd, &hdr, sizeof(hdr), 0)
+    || (ftruncate (fd, DataStart(nLeaves) + nElems * EltSzB(kind)) < 0)) {
+	close (fd);
+	return 0;
+    }
+
+    RopeFile_t *rf = NEW(RopeFile_t);
+    rf->fd = fd;
+    rf->kind = kind;
+    rf->nLeaves = nLeaves;
+
+    return rf;
+}
+
+int32_t M_RopeFileWriteLeaf (void *rf, int64_t ix, int64_t eltOff, void *col0, void *col1, int32_t n)
+{
+    RopeFile_t		*f = (RopeFile_t *)rf;
+    RopeFileLeaf_t	leaf;
+    int			sz0 = ColSzB[f->kind][0];
+    int			sz1 = ColSzB[f->kind][1];
+
+    assert ((0 <= ix) && (ix < f->nLeaves));
+
+    leaf.offset = DataStart(f->nLeaves) + eltOff * (sz0 + sz1);
+    leaf.nElems = n;
+
+    if (!WriteAll (f->fd, &leaf, sizeof(leaf), sizeof(RopeFileHdr_t) + ix * sizeof(leaf)))
+	return 0;
+    if (!WriteAll (f->fd, col0, (size_t)n * sz0, leaf.offset))
+	return 0;
+    if ((sz1 > 0) && !WriteAll (f->fd, col1, (size_t)n * sz1, leaf.offset + (int64_t)n * sz0))
+	return 0;
+
+    return 1;
+}
+
+int32_t M_RopeFileClose (void *rf)
+{
+    RopeFile_t *f = (RopeFile_t *)rf;
+
+    int sts = close (f->fd);
+    FREE (f);
+
+    return (sts == 0);
+}
+
+int64_t M_RopeFileNumLeaves (void *mf, int32_t kind)
+{
+    MappedFile_t	*f = (MappedFile_t *)mf;
+    RopeFileHdr_t	hdr;
+    RopeFileLeaf_t	leaf;
+
+    if ((f == 0) || (f->len < (int64_t)sizeof(hdr)) || !ValidKind(kind))
+	return -1;
+
+    memcpy (&hdr, f->data, sizeof(hdr));
+    if ((memcmp (hdr.magic, ROPE_FILE_MAGIC, sizeof(hdr.magic)) != 0)
+    || (hdr.version != ROPE_FILE_VERSION)
+    || (hdr.kind != (uint32_t)kind)
+    || (hdr.nLeaves > (f->len - sizeof(hdr)) / sizeof(leaf)))
+	return -1;
+
+  /* check the index, so that reading the leaves cannot go past the end of the file */
+    int64_t eltSzB = EltSzB(kind);
+    for (uint64_t i = 0;  i < hdr.nLeaves;  i++) {
+	memcpy (&leaf, f->data + sizeof(hdr) + i * sizeof(leaf), sizeof(leaf));
+	if ((leaf.nElems > INT32_MAX)
+	|| (leaf.offset > (uint64_t)f->len)
+	|| (leaf.nElems * eltSzB > f->len - leaf.offset))
+	    return -1;
+    }
+
+    return hdr.nLeaves;
+}
+
+int64_t M_RopeFileLeafOffset (void *mf, int64_t ix)
+{
+    RopeFileLeaf_t leaf;
+
+    memcpy (&leaf, ((MappedFile_t *)mf)->data + sizeof(RopeFileHdr_t) + ix * sizeof(leaf), sizeof(leaf));
+    return leaf.offset;
+}
+
+int32_t M_RopeFileLeafLength (void *mf, int64_t ix)
+{
+    RopeFileLeaf_t leaf;
+
+    memcpy (&leaf, ((MappedFile_t *)mf)->data + sizeof(RopeFileHdr_t) + ix * sizeof(leaf), sizeof(leaf));
+    return leaf.nElems;
+}
@@ -3,6 +3,11 @@
  * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
  * All rights reserved.
  *
+ * Per-vproc hardware performance counters.  Each vproc counts the events that were
+ * selected by the -perf-events option using the perf_event_open(2) system call.
+ * The counts are attributed to the phase that the vproc was in (mutator, minor
+ * GC, major GC, global GC, promotion, or idle) by reading the counters at each
+ * phase change.
  */
 
 #include "manticore-rt.h"
@@ -19,8 +24,6 @@
 #include <sys/uio.h>
 #include <errno.h>
 
-#include <linux/unistd.h>
-
 #include <assert.h>
 #include <unistd.h>
 #include <stdlib.h>
@@ -34,93 +37,235 @@ static bool	ReportStatsFlg = false;	// true for report enabled
 static bool	CSVStatsFlg = false;	// true for CSV-format report
 static bool	SMLStatsFlg = false;	// true for SML-format report
 
-#define __NR_perf_counter_open 298
+/* the events that are counted if -perf is given without -perf-events */
+#define DFLT_PERF_EVENTS	"cycles,instructions,llc-loads,llc-misses"
+
+#define HW_CACHE_EVENT(cache, op, result)	\
+	((cache) | ((op) << 8) | ((result) << 16))
+
+/* the generic events that can be named in the -perf-events option */
+static struct {
+    const char	*name;
+    uint32_t	type;
+    uint64_t	config;
+} GenericEvents[] = {
+    { "cycles",		PERF_TYPE_HARDWARE,	PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions",	PERF_TYPE_HARDWARE,	PERF_COUNT_HW_INSTRUCTIONS },
+    { "cache-refs",	PERF_TYPE_HARDWARE,	PERF_COUNT_HW_CACHE_REFERENCES },
+    { "cache-misses",	PERF_TYPE_HARDWARE,	PERF_COUNT_HW_CACHE_MISSES },
+    { "branches",	PERF_TYPE_HARDWARE,	PERF_COUNT_HW_BRANCH_INSTRUCTIONS },
+    { "branch-misses",	PERF_TYPE_HARDWARE,	PERF_COUNT_HW_BRANCH_MISSES },
+    { "llc-loads",	PERF_TYPE_HW_CACHE,
+	HW_CACHE_EVENT(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_ACCESS) },
+    { "llc-misses",	PERF_TYPE_HW_CACHE,
+	HW_CACHE_EVENT(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS) },
+    { "dtlb-loads",	PERF_TYPE_HW_CACHE,
+	HW_CACHE_EVENT(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_ACCESS) },
+    { "dtlb-misses",	PERF_TYPE_HW_CACHE,
+	HW_CACHE_EVENT(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS) },
+    { "page-faults",	PERF_TYPE_SOFTWARE,	PERF_COUNT_SW_PAGE_FAULTS },
+    { "context-switches", PERF_TYPE_SOFTWARE,	PERF_COUNT_SW_CONTEXT_SWITCHES },
+    { 0, 0, 0 }
+};
+
+/* the events selected by the -perf-events option */
+int		NumPerfEvents = 0;
+static char	*PerfEventNames[MAX_PERF_EVENTS];
+static uint32_t	PerfEventTypes[MAX_PERF_EVENTS];
+static uint64_t	PerfEventConfigs[MAX_PERF_EVENTS];
+
+static const char *PhaseNames[NUM_PERF_PHASES] = {
+	"mutator", "minorGC", "majorGC", "globalGC", "promote", "idle"
+    };
+
+STATIC_INLINE int perf_event_open (
+    struct perf_event_attr *attr,
+    pid_t pid, int cpu, int group_fd,
+    unsigned long flags)
+{
+    return syscall(__NR_perf_event_open, attr, pid, cpu, group_fd, flags);
+}
 
-static inline int
-perf_counter_open(struct perf_counter_attr *attr,
-                      pid_t pid, int cpu, int group_fd,
-                      unsigned long flags)
+/* add the named event to the list of events to count.  Besides the generic names
+ * in the GenericEvents table, raw event codes can be given as "rNNNN", where NNNN
+ * is a hexadecimal number.
+ */
+static bool AddPerfEvent (const char *name)
 {
-    return syscall(__NR_perf_counter_open, attr, pid, cpu, group_fd, flags);
+    if (NumPerfEvents == MAX_PERF_EVENTS) {
+	Error("too many perf events; ignoring \"%s\"\n", name);
+	return false;
+    }
+
+    if ((name[0] == 'r') && (name[1] != '\0')) {
+	char *end;
+	uint64_t config = strtoull (name+1, &end, 16);
+	if (*end == '\0') {
+	    PerfEventNames[NumPerfEvents] = strdup(name);
+	    PerfEventTypes[NumPerfEvents] = PERF_TYPE_RAW;
+	    PerfEventConfigs[NumPerfEvents] = config;
+	    NumPerfEvents++;
+	    return true;
+	}
+    }
+
+    for (int i = 0;  GenericEvents[i].name != 0;  i++) {
+	if (strcmp(name, GenericEvents[i].name) == 0) {
+	    PerfEventNames[NumPerfEvents] = strdup(name);
+	    PerfEventTypes[NumPerfEvents] = GenericEvents[i].type;
+	    PerfEventConfigs[NumPerfEvents] = GenericEvents[i].config;
+	    NumPerfEvents++;
+	    return true;
+	}
+    }
+
+    Error("unknown perf event \"%s\"\n", name);
+    return false;
+
 }
 
 /* process command-line args */
 void ParsePerfOptions (Options_t *opts)
 {
+  /* NOTE: GetStringEqOpt matches prefixes, so we have to check for -perf-events first */
+    const char *events = GetStringEqOpt (opts, "-perf-events", DFLT_PERF_EVENTS);
     const char *report = GetStringEqOpt (opts, "-perf", "summary");
 
+    if ((report == 0) && (events != 0))
+	report = "summary";
+
     if (report != 0) {
         ReportStatsFlg = true;
         if (strstr(report, "csv") != 0) CSVStatsFlg = true;
         if (strstr(report, "sml") != 0) SMLStatsFlg = true;
+
+	char *evts = strdup ((events == 0) ? DFLT_PERF_EVENTS : events);
+	char *input = evts, *tok;
+	while ((tok = strsep(&input, ",")) != 0) {
+	    if (*tok != '\0')
+		AddPerfEvent (tok);
+	}
+	FREE (evts);
     }
 }
 
-void initCounter(PerfCntrs_t *p)
+const char *PerfEventName (int i)
 {
-    p->nonGC = 0;
-    p->GC = 0;
-    p->last = 0;
-    p->inGC = false;
-    p->fd = -1;
+    assert ((0 <= i) && (i < NumPerfEvents));
+    return PerfEventNames[i];
 }
 
-// Forces a state transition, which updates the counter value
-// members a final time.
-void stopCounter(PerfCntrs_t *p)
+const char *PerfPhaseName (PerfPhase_t phase)
 {
-    if (!p->enabled)
-        return;
+    return PhaseNames[phase];
+}
 
-    if (p->inGC)
-    {
-        PERF_StopGC(p);
+/* InitPerfCounters:
+ *
+ * Initialize the perf counters for the given vproc.  This function must be called
+ * by the vproc's host thread, since the counters only count events for the
+ * calling thread.
+ */
+void InitPerfCounters (VProc_t *vp)
+{
+    PerfCntrs_t *p = &(vp->perf);
+    struct perf_event_attr attr;
+
+    p->nEvents = 0;
+    p->depth = 1;
+    p->phases[0] = PERF_MUTATOR;
+    for (int i = 0;  i < MAX_PERF_EVENTS;  i++) {
+	p->fd[i] = -1;
+	p->last[i] = 0;
+	for (int j = 0;  j < NUM_PERF_PHASES;  j++)
+	    p->counts[j][i] = 0;
     }
-    else
-    {
-        PERF_StartGC(p);
+
+    if (! ReportStatsFlg)
+	return;
+
+  /* the counters are opened as a group, so that they can all be read by one
+   * read(2) on the group leader.
+   */
+    for (int i = 0;  i < NumPerfEvents;  i++) {
+	memset (&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PerfEventTypes[i];
+	attr.config = PerfEventConfigs[i];
+	attr.read_format = PERF_FORMAT_GROUP;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	int fd = perf_event_open (&attr, 0, -1, (i == 0) ? -1 : p->fd[0], 0);
+	if (fd < 0) {
+	    Warning("unable to open perf event \"%s\" on vproc %d; errno = %d\n",
+		PerfEventNames[i], vp->id, errno);
+	    for (int j = 0;  j < i;  j++) {
+		close (p->fd[j]);
+		p->fd[j] = -1;
+	    }
+	    return;
+	}
+	p->fd[i] = fd;
     }
 
-    close (p->fd);
-    p->fd = -1;
+    p->nEvents = NumPerfEvents;
+
 }
 
-/* InitPerfCounters:
- *
- * Initialize the perf counters for the given vproc.
+/* read the counters for a vproc and attribute the events since the last read
+ * to its current phase.
  */
-void InitPerfCounters (VProc_t *vp)
+static void ReadCounters (PerfCntrs_t *p)
 {
-    struct perf_counter_attr attr;
-    int cpu = -1;
-
-    if (vp->location == Location(LocationNode(vp->location), 0, 0)) {
-        vp->reads.enabled = true;
-        vp->misses.enabled = true;
-    } else {
-        vp->reads.enabled = false;
-        vp->misses.enabled = false;
+    uint64_t buf[MAX_PERF_EVENTS + 1];
+
+    if (p->nEvents == 0)
+	return;
+
+    ssize_t nb = read (p->fd[0], buf, sizeof(buf));
+    if ((nb < (ssize_t)sizeof(uint64_t)) || (buf[0] != (uint64_t)p->nEvents))
+	return;
+
+    PerfPhase_t phase = p->phases[p->depth-1];
+    for (int i = 0;  i < p->nEvents;  i++) {
+	p->counts[phase][i] += buf[i+1] - p->last[i];
+	p->last[i] = buf[i+1];
+    }
+
+}
+
+void PERF_PushPhase (VProc_t *vp, PerfPhase_t phase)
+{
+    PerfCntrs_t *p = &(vp->perf);
+
+    assert (p->depth < MAX_PERF_DEPTH);
+    ReadCounters (p);
+    p->phases[p->depth++] = phase;
+
+}
+
+void PERF_PopPhase (VProc_t *vp)
+{
+    PerfCntrs_t *p = &(vp->perf);
+
+    assert (p->depth > 1);
+    ReadCounters (p);
+    p->depth--;
+
+}
+
+// Forces a final read of the counters and closes them.
+static void StopCounters (PerfCntrs_t *p)
+{
+    if (p->nEvents == 0)
         return;
-    }        
-
-    int core = (vp->location >> LOC_THREAD_BITS) & ((1 << LOC_CORE_BITS) - 1);
-    
-    memset (&attr, 0, sizeof(attr));
-    attr.sample_type = PERF_SAMPLE_IP | PERF_SAMPLE_TID;
-    attr.freq = 0;
-    
-    attr.type = PERF_TYPE_RAW;
-    attr.config = 0xF74E0;
-    //fprintf (stderr, "Core %d = %x mask, %x config\n", core, mask, attr.config);
-    attr.inherit = 0;
-    attr.size = sizeof(struct perf_counter_attr);
-
-    initCounter (&vp->reads);
-    vp->reads.fd = perf_counter_open (&attr, 0, cpu, -1, 0);
-
-    attr.config = 0xF74E1;
-    initCounter (&vp->misses);
-    vp->misses.fd  = perf_counter_open (&attr, 0, cpu, vp->reads.fd, 0);
+
+    ReadCounters (p);
+
+    for (int i = 0;  i < p->nEvents;  i++) {
+	close (p->fd[i]);
+	p->fd[i] = -1;
+    }
 }
 
 void ReportPerfCounters () {
@@ -130,19 +275,21 @@ void ReportPerfCounters () {
     FILE *StatsOutFile = stderr;
 
     for (int i = 0;  i < NumVProcs;  i++) {
-        VProc_t *vp = VProcs[i];
-        stopCounter (&vp->reads);
-        stopCounter (&vp->misses);
+        StopCounters (&(VProcs[i]->perf));
     }
-    
+
     if (CSVStatsFlg) {
         if ((StatsOutFile = fopen ("perf.csv", "w")) == 0)
             StatsOutFile = stderr;
 
         for (int i = 0;  i < NumVProcs;  i++) {
-            VProc_t *vp = VProcs[i];
-            if (vp->misses.enabled)
-                fprintf(StatsOutFile, "%" PRIi64 ", %" PRIi64 ", %" PRIi64 ", %" PRIi64 ", %" PRIi64 "\n", i, vp->misses.nonGC, vp->misses.GC, vp->reads.nonGC, vp->reads.GC);
+            PerfCntrs_t *p = &(VProcs[i]->perf);
+	    for (int e = 0;  e < p->nEvents;  e++) {
+		fprintf (StatsOutFile, "p%02d, %s", i, PerfEventNames[e]);
+		for (int ph = 0;  ph < NUM_PERF_PHASES;  ph++)
+		    fprintf (StatsOutFile, ", %" PRIu64, p->counts[ph][e]);
+		fprintf (StatsOutFile, "\n");
+	    }
         }
 
         fclose (StatsOutFile);
@@ -152,15 +299,13 @@ void ReportPerfCounters () {
             StatsOutFile = stderr;
 
         for (int i = 0;  i < NumVProcs;  i++) {
-            VProc_t *vp = VProcs[i];
-            
-            if (vp->misses.enabled)
-                fprintf (StatsOutFile,
-                         "PST{processor=%d, \n\
-                      nonGCmiss=%" PRIi64 ", GCmiss=%" PRIi64 ",\n                    \
-                      nonGCreferences=%" PRIi64 ", GCreferences=%" PRIi64 "} ::\n",
-                         i, vp->misses.nonGC, vp->misses.GC,
-                         vp->reads.nonGC, vp->reads.GC);
+            PerfCntrs_t *p = &(VProcs[i]->perf);
+	    for (int e = 0;  e < p->nEvents;  e++) {
+		fprintf (StatsOutFile, "PST{processor=%d, event=\"%s\"", i, PerfEventNames[e]);
+		for (int ph = 0;  ph < NUM_PERF_PHASES;  ph++)
+		    fprintf (StatsOutFile, ", %s=%" PRIu64, PhaseNames[ph], p->counts[ph][e]);
+		fprintf (StatsOutFile, "} ::\n");
+	    }
         }
 
         fprintf (StatsOutFile, "nil\n");
@@ -168,45 +313,19 @@ void ReportPerfCounters () {
         fclose (StatsOutFile);
     }
     else {
+	fprintf (stderr, "vproc event           ");
+	for (int ph = 0;  ph < NUM_PERF_PHASES;  ph++)
+	    fprintf (stderr, " %14s", PhaseNames[ph]);
+	fprintf (stderr, "\n");
         for (int i = 0;  i < NumVProcs;  i++) {
-            VProc_t *vp = VProcs[i];
-            
-            if (vp->misses.enabled)
-                fprintf(stderr, "vproc %d, %" PRIi64 " nonGC misses, %" PRIi64 " GC misses, %" PRIi64 " nonGC reads, %" PRIi64 " GC reads\n",
-                        i, vp->misses.nonGC, vp->misses.GC, vp->reads.nonGC, vp->reads.GC);
+            PerfCntrs_t *p = &(VProcs[i]->perf);
+	    for (int e = 0;  e < p->nEvents;  e++) {
+		fprintf (stderr, "p%02d   %-16s", i, PerfEventNames[e]);
+		for (int ph = 0;  ph < NUM_PERF_PHASES;  ph++)
+		    fprintf (stderr, " %14" PRIu64, p->counts[ph][e]);
+		fprintf (stderr, "\n");
+	    }
         }
     }
 
 }
-
-void PERF_StartGC(PerfCntrs_t *p)
-{
-    if (!p->enabled)
-        return;
-
-    assert(!p->inGC);
-
-    unsigned long long count;
-    int ignored = read(p->fd, &count, sizeof(count));
-
-    p->nonGC += (count - p->last);
-    p->last = count;
-
-    p->inGC = true;
-}
-
-void PERF_StopGC(PerfCntrs_t *p)
-{
-    if (!p->enabled)
-        return;
-
-    assert(p->inGC);
-
-    unsigned long long count;
-    int ignored = read(p->fd, &count, sizeof(count));
-
-    p->GC += (count - p->last);
-    p->last = count;
-    
-    p->inGC = false;
-}
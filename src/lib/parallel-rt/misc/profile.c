@@ -0,0 +1,221 @@
+/* profile.c
+ *
+ * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
+ * All rights reserved.
+ *
+ * A SIGPROF-based sampling profiler.  Each vproc has a POSIX timer that counts the
+ * CPU time of its host thread and signals that thread.  The signal handler records
+ * the interrupted program counter and the vproc's atomic flag in a per-vproc
+ * sample buffer.  Since the buffer is only written by its vproc's signal handler,
+ * and is only read once the vprocs have stopped, it does not need any locking.
+ *
+ * The profile file has the following line-oriented format:
+ *
+ *	manticore-profile 1
+ *	rate <samples per second>
+ *	nvprocs <n>
+ *	func <address> <name>			(one per Manticore function)
+ *	sample <vproc> <pc> <atomic> <count>	(one per distinct pc/atomic pair)
+ *	dropped <vproc> <count>			(only if the buffer overflowed)
+ *
+ * Addresses are in hex.
+ */
+
+#include "manticore-rt.h"
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <unistd.h>
+#if defined(TARGET_LINUX)
+#  include <ucontext.h>
+#  include <sys/syscall.h>
+#endif
+#include "options.h"
+#include "value.h"
+#include "vproc.h"
+#include "profile.h"
+
+#define PROF_BUF_SZ	(256*1024)	/* maximum number of samples per vproc */
+
+#ifndef sigev_notify_thread_id
+#  define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+typedef struct {
+    Addr_t	pc;		// the interrupted program counter
+    uint32_t	atomic;		// true if the vproc was in an atomic region
+} ProfSample_t;
+
+typedef struct {
+    ProfSample_t	*samples;
+    volatile uint32_t	nSamples;	// number of samples in the buffer
+    uint32_t		nDropped;	// number of samples lost to overflow
+    bool		running;	// true if the timer has been created
+#if defined(TARGET_LINUX)
+    timer_t		timer;
+#endif
+} ProfBuf_t;
+
+/* the table of Manticore functions; generated by the compiler */
+extern ProfTblEntry_t	mantProfTbl[];
+
+bool			ProfileFlg = false;
+static const char	*ProfFile;		// the name of the profile file
+static int		ProfRate;		// samples per second
+static ProfBuf_t	ProfBufs[MAX_NUM_VPROCS];
+
+#if defined(TARGET_LINUX)
+static void ProfHandler (int sig, siginfo_t *si, void *_uc);
+#endif
+
+void InitProfiler (Options_t *opts)
+{
+  /* NOTE: GetStringEqOpt matches prefixes, so we have to check for -profrate first */
+    ProfRate = GetIntOpt (opts, "-profrate", DFLT_PROF_RATE);
+    ProfFile = GetStringEqOpt (opts, "-prof", DFLT_PROF_FILE);
+
+    if (ProfFile == 0)
+	return;
+
+#if defined(TARGET_LINUX)
+    if ((ProfRate <= 0) || (ProfRate > 1000000)) {
+	Warning ("invalid profiling rate %d; using %d\n", ProfRate, DFLT_PROF_RATE);
+	ProfRate = DFLT_PROF_RATE;
+    }
+
+    struct sigaction sa;
+    sa.sa_sigaction = ProfHandler;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigfillset (&(sa.sa_mask));
+    sigaction (SIGPROF, &sa, 0);
+
+    ProfileFlg = true;
+#else
+    Warning ("profiling is not supported on this platform\n");
+#endif
+
+}
+
+void ProfStartVProc (VProc_t *vp)
+{
+    if (! ProfileFlg)
+	return;
+
+#if defined(TARGET_LINUX)
+    ProfBuf_t *buf = &(ProfBufs[vp->id]);
+    buf->samples = NEWVEC(ProfSample_t, PROF_BUF_SZ);
+    buf->nSamples = 0;
+    buf->nDropped = 0;
+    if (buf->samples == 0) {
+	Warning ("unable to allocate profile buffer for vproc %d\n", vp->id);
+	return;
+    }
+
+  /* create a timer that counts this thread's CPU time and signals this thread */
+    struct sigevent sev;
+    memset (&sev, 0, sizeof(sev));
+    sev.sigev_notify = SIGEV_THREAD_ID;
+    sev.sigev_signo = SIGPROF;
+    sev.sigev_notify_thread_id = syscall(SYS_gettid);
+    if (timer_create (CLOCK_THREAD_CPUTIME_ID, &sev, &(buf->timer)) < 0) {
+	Warning ("unable to create profile timer for vproc %d; errno = %d\n", vp->id, errno);
+	return;
+    }
+    buf->running = true;
+
+    struct itimerspec its;
+    long ns = 1000000000L / ProfRate;
+    its.it_interval.tv_sec = ns / 1000000000L;
+    its.it_interval.tv_nsec = ns % 1000000000L;
+    its.it_value = its.it_interval;
+    timer_settime (buf->timer, 0, &its, 0);
+#endif
+
+}
+
+#if defined(TARGET_LINUX)
+static void ProfHandler (int sig, siginfo_t *si, void *_uc)
+{
+    VProc_t *vp = VProcSelf();
+    if (vp == 0)
+	return;
+
+    ProfBuf_t *buf = &(ProfBufs[vp->id]);
+    uint32_t n = buf->nSamples;
+    if (n < PROF_BUF_SZ) {
+	ucontext_t *uc = (ucontext_t *)_uc;
+	buf->samples[n].pc = (Addr_t)uc->uc_mcontext.gregs[REG_RIP];
+	buf->samples[n].atomic = (vp->atomic == M_TRUE);
+	buf->nSamples = n+1;
+    }
+    else
+	buf->nDropped++;
+
+}
+#endif
+
+static int CompareSamples (const void *a, const void *b)
+{
+    const ProfSample_t *s1 = (const ProfSample_t *)a;
+    const ProfSample_t *s2 = (const ProfSample_t *)b;
+
+    if (s1->pc < s2->pc) return -1;
+    else if (s1->pc > s2->pc) return 1;
+    else return (int)s1->atomic - (int)s2->atomic;
+}
+
+void WriteProfile ()
+{
+    if (! ProfileFlg)
+	return;
+
+  /* stop sampling */
+#if defined(TARGET_LINUX)
+    for (int i = 0;  i < NumVProcs;  i++) {
+	if (ProfBufs[i].running) {
+	    timer_delete (ProfBufs[i].timer);
+	    ProfBufs[i].running = false;
+	}
+    }
+#endif
+
+    FILE *f = fopen (ProfFile, "w");
+    if (f == 0) {
+	Error ("unable to open profile file \"%s\"\n", ProfFile);
+	return;
+    }
+
+    fprintf (f, "manticore-profile 1\n");
+    fprintf (f, "rate %d\n", ProfRate);
+    fprintf (f, "nvprocs %d\n", NumVProcs);
+
+    for (ProfTblEntry_t *p = mantProfTbl;  p->addr != 0;  p++) {
+	fprintf (f, "func %" PRIxPTR " %s\n", (uintptr_t)p->addr, p->name);
+    }
+
+  /* sort each vproc's samples so that we can output a count per distinct sample */
+    for (int i = 0;  i < NumVProcs;  i++) {
+	ProfBuf_t *buf = &(ProfBufs[i]);
+	uint32_t n = buf->nSamples;
+	if (n == 0)
+	    continue;
+	qsort (buf->samples, n, sizeof(ProfSample_t), CompareSamples);
+	uint32_t j = 0;
+	while (j < n) {
+	    uint32_t k = j+1;
+	    while ((k < n) && (CompareSamples(&(buf->samples[j]), &(buf->samples[k])) == 0))
+		k++;
+	    fprintf (f, "sample %d %" PRIxPTR " %d %u\n",
+		i, (uintptr_t)buf->samples[j].pc, buf->samples[j].atomic, k - j);
+	    j = k;
+	}
+	if (buf->nDropped > 0)
+	    fprintf (f, "dropped %d %u\n", i, buf->nDropped);
+    }
+
+    fclose (f);
+
+}
@@ -0,0 +1,446 @@
+/* vector-kernels.c
+ *
+ * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
+ * All rights reserved.
+ *
+ * Leaf kernels over unboxed int and double arrays (see vector-kernels.h).  The
+ * AVX2 versions are compiled with a function-level target attribute, so the rest
+ * of the runtime does not depend on AVX2, and they are selected once at startup.
+ * The scalar versions do their int arithmetic on unsigned values, so that
+ * overflow wraps around like it does in the vector versions.
+ */
+
+#include "manticore-rt.h"
+#include "options.h"
+#include "vector-kernels.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#  define HAVE_AVX2_KERNELS
+#  include <immintrin.h>
+#  define AVX2_FN __attribute__((target("avx2")))
+#endif
+
+static bool	UseAVX2 = false;	// true if the AVX2 kernels are used
+
+void InitVectorKernels (Options_t *opts)
+{
+    bool noVec = GetFlagOpt (opts, "-novec");
+
+#ifdef HAVE_AVX2_KERNELS
+    __builtin_cpu_init ();
+    UseAVX2 = !noVec && __builtin_cpu_supports ("avx2");
+#endif
+
+}
+
+/********** Scalar kernels **********/
+
+static int32_t IntSumScalar (int32_t *a, int n)
+{
+    uint32_t s = 0;
+    for (int i = 0;  i < n;  i++)
+	s += (uint32_t)a[i];
+    return (int32_t)s;
+}
+
+static int32_t IntMinScalar (int32_t *a, int n)
+{
+    int32_t m = a[0];
+    for (int i = 1;  i < n;  i++)
+	if (a[i] < m) m = a[i];
+    return m;
+}
+
+static int32_t IntMaxScalar (int32_t *a, int n)
+{
+    int32_t m = a[0];
+    for (int i = 1;  i < n;  i++)
+	if (a[i] > m) m = a[i];
+    return m;
+}
+
+static int32_t IntDotScalar (int32_t *a, int32_t *b, int n)
+{
+    uint32_t s = 0;
+    for (int i = 0;  i < n;  i++)
+	s += (uint32_t)a[i] * (uint32_t)b[i];
+    return (int32_t)s;
+}
+
+static double DoubleSumScalar (double *a, int n)
+{
+    double s = 0.0;
+    for (int i = 0;  i < n;  i++)
+	s += a[i];
+    return s;
+}
+
+static double DoubleMinScalar (double *a, int n)
+{
+    double m = a[0];
+    for (int i = 1;  i < n;  i++)
+	if (a[i] < m) m = a[i];
+    return m;
+}
+
+static double DoubleMaxScalar (double *a, int n)
+{
+    double m = a[0];
+    for (int i = 1;  i < n;  i++)
+	if (a[i] > m) m = a[i];
+    return m;
+}
+
+static double DoubleDotScalar (double *a, double *b, int n)
+{
+    double s = 0.0;
+    for (int i = 0;  i < n;  i++)
+	s += a[i] * b[i];
+    return s;
+}
+
+static int32_t IntPrefixSumScalar (int32_t *dst, int32_t *a, int n, int32_t init)
+{
+    uint32_t s = (uint32_t)init;
+    for (int i = 0;  i < n;  i++) {
+	uint32_t x = (uint32_t)a[i];
+	dst[i] = (int32_t)s;
+	s += x;
+    }
+    return (int32_t)s;
+}
+
+/********** AVX2 kernels **********/
+
+#ifdef HAVE_AVX2_KERNELS
+
+/* horizontal sums of a vector */
+AVX2_FN STATIC_INLINE int32_t HSumI32 (__m256i v)
+{
+    __m128i x = _mm_add_epi32 (_mm256_castsi256_si128 (v), _mm256_extracti128_si256 (v, 1));
+    x = _mm_add_epi32 (x, _mm_shuffle_epi32 (x, 0x4e));
+    x = _mm_add_epi32 (x, _mm_shuffle_epi32 (x, 0xb1));
+    return _mm_cvtsi128_si32 (x);
+}
+
+AVX2_FN STATIC_INLINE double HSumF64 (__m256d v)
+{
+    __m128d x = _mm_add_pd (_mm256_castpd256_pd128 (v), _mm256_extractf128_pd (v, 1));
+    x = _mm_add_sd (x, _mm_unpackhi_pd (x, x));
+    return _mm_cvtsd_f64 (x);
+}
+
+AVX2_FN static int32_t IntSumAVX2 (int32_t *a, int n)
+{
+    __m256i s0 = _mm256_setzero_si256 (), s1 = _mm256_setzero_si256 ();
+    int i = 0;
+    for (;  i + 16 <= n;  i += 16) {
+	s0 = _mm256_add_epi32 (s0, _mm256_loadu_si256 ((__m256i *)(a + i)));
+	s1 = _mm256_add_epi32 (s1, _mm256_loadu_si256 ((__m256i *)(a + i + 8)));
+    }
+    for (;  i + 8 <= n;  i += 8)
+	s0 = _mm256_add_epi32 (s0, _mm256_loadu_si256 ((__m256i *)(a + i)));
+    return (int32_t)((uint32_t)HSumI32 (_mm256_add_epi32 (s0, s1))
+	+ (uint32_t)IntSumScalar (a + i, n - i));
+}
+
+AVX2_FN static int32_t IntMinAVX2 (int32_t *a, int n)
+{
+    if (n < 8)
+	return IntMinScalar (a, n);
+    __m256i m = _mm256_loadu_si256 ((__m256i *)a);
+    int i = 8;
+    for (;  i + 8 <= n;  i += 8)
+	m = _mm256_min_epi32 (m, _mm256_loadu_si256 ((__m256i *)(a + i)));
+    int32_t buf[8];
+    _mm256_storeu_si256 ((__m256i *)buf, m);
+    int32_t r = IntMinScalar (buf, 8);
+    for (;  i < n;  i++)
+	if (a[i] < r) r = a[i];
+    return r;
+}
+
+AVX2_FN static int32_t IntMaxAVX2 (int32_t *a, int n)
+{
+    if (n < 8)
+	return IntMaxScalar (a, n);
+    __m256i m = _mm256_loadu_si256 ((__m256i *)a);
+    int i = 8;
+    for (;  i + 8 <= n;  i += 8)
+	m = _mm256_max_epi32 (m, _mm256_loadu_si256 ((__m256i *)(a + i)));
+    int32_t buf[8];
+    _mm256_storeu_si256 ((__m256i *)buf, m);
+    int32_t r = IntMaxScalar (buf, 8);
+    for (;  i < n;  i++)
+	if (a[i] > r) r = a[i];
+    return r;
+}
+
+AVX2_FN static int32_t IntDotAVX2 (int32_t *a, int32_t *b, int n)
+{
+    __m256i s = _mm256_setzero_si256 ();
+    int i = 0;
+    for (;  i + 8 <= n;  i += 8) {
+	__m256i x = _mm256_loadu_si256 ((__m256i *)(a + i));
+	__m256i y = _mm256_loadu_si256 ((__m256i *)(b + i));
+	s = _mm256_add_epi32 (s, _mm256_mullo_epi32 (x, y));
+    }
+    return (int32_t)((uint32_t)HSumI32 (s) + (uint32_t)IntDotScalar (a + i, b + i, n - i));
+}
+
+AVX2_FN static double DoubleSumAVX2 (double *a, int n)
+{
+    __m256d s0 = _mm256_setzero_pd (), s1 = _mm256_setzero_pd ();
+    __m256d s2 = _mm256_setzero_pd (), s3 = _mm256_setzero_pd ();
+    int i = 0;
+    for (;  i + 16 <= n;  i += 16) {
+	s0 = _mm256_add_pd (s0, _mm256_loadu_pd (a + i));
+	s1 = _mm256_add_pd (s1, _mm256_loadu_pd (a + i + 4));
+	s2 = _mm256_add_pd (s2, _mm256_loadu_pd (a + i + 8));
+	s3 = _mm256_add_pd (s3, _mm256_loadu_pd (a + i + 12));
+    }
+    for (;  i + 4 <= n;  i += 4)
+	s0 = _mm256_add_pd (s0, _mm256_loadu_pd (a + i));
+    __m256d s = _mm256_add_pd (_mm256_add_pd (s0, s1), _mm256_add_pd (s2, s3));
+    return HSumF64 (s) + DoubleSumScalar (a + i, n - i);
+}
+
+AVX2_FN static double DoubleMinAVX2 (double *a, int n)
+{
+    if (n < 4)
+	return DoubleMinScalar (a, n);
+    __m256d m = _mm256_loadu_pd (a);
+    int i = 4;
+    for (;  i + 4 <= n;  i += 4)
+	m = _mm256_min_pd (m, _mm256_loadu_pd (a + i));
+    double buf[4];
+    _mm256_storeu_pd (buf, m);
+    double r = DoubleMinScalar (buf, 4);
+    for (;  i < n;  i++)
+	if (a[i] < r) r = a[i];
+    return r;
+}
+
+AVX2_FN static double DoubleMaxAVX2 (double *a, int n)
+{
+    if (n < 4)
+	return DoubleMaxScalar (a, n);
+    __m256d m = _mm256_loadu_pd (a);
+    int i = 4;
+    for (;  i + 4 <= n;  i += 4)
+	m = _mm256_max_pd (m, _mm256_loadu_pd (a + i));
+    double buf[4];
+    _mm256_storeu_pd (buf, m);
+    double r = DoubleMaxScalar (buf, 4);
+    for (;  i < n;  i++)
+	if (a[i] > r) r = a[i];
+    return r;
+}
+
+AVX2_FN static double DoubleDotAVX2 (double *a, double *b, int n)
+{
+    __m256d s0 = _mm256_setzero_pd (), s1 = _mm256_setzero_pd ();
+    int i = 0;
+    for (;  i + 8 <= n;  i += 8) {
+	s0 = _mm256_add_pd (s0, _mm256_mul_pd (_mm256_loadu_pd (a + i), _mm256_loadu_pd (b + i)));
+	s1 = _mm256_add_pd (s1, _mm256_mul_pd (_mm256_loadu_pd (a + i + 4), _mm256_loadu_pd (b + i + 4)));
+    }
+    for (;  i + 4 <= n;  i += 4)
+	s0 = _mm256_add_pd (s0, _mm256_mul_pd (_mm256_loadu_pd (a + i), _mm256_loadu_pd (b + i)));
+    return HSumF64 (_mm256_add_pd (s0, s1)) + DoubleDotScalar (a + i, b + i, n - i);
+}
+
+/* the prefix sum of eight ints is computed in registers: first within each
+ * 128-bit lane and then the total of the low lane is added to the high lane.
+ * Subtracting the input gives the exclusive sums.
+ */
+AVX2_FN static int32_t IntPrefixSumAVX2 (int32_t *dst, int32_t *a, int n, int32_t init)
+{
+    __m256i carry = _mm256_set1_epi32 (init);
+    __m256i last = _mm256_set1_epi32 (7);
+    int i = 0;
+    for (;  i + 8 <= n;  i += 8) {
+	__m256i x = _mm256_loadu_si256 ((__m256i *)(a + i));
+	__m256i s = _mm256_add_epi32 (x, _mm256_slli_si256 (x, 4));
+	s = _mm256_add_epi32 (s, _mm256_slli_si256 (s, 8));
+	__m256i lo = _mm256_shuffle_epi32 (s, 0xff);
+	s = _mm256_add_epi32 (s, _mm256_permute2x128_si256 (lo, lo, 0x08));
+	s = _mm256_add_epi32 (s, carry);
+	_mm256_storeu_si256 ((__m256i *)(dst + i), _mm256_sub_epi32 (s, x));
+	carry = _mm256_permutevar8x32_epi32 (s, last);
+    }
+    return IntPrefixSumScalar (dst + i, a + i, n - i, _mm256_cvtsi256_si32 (carry));
+}
+
+#define LOADI(p)	_mm256_loadu_si256 ((__m256i *)(p))
+#define STOREI(p, v)	_mm256_storeu_si256 ((__m256i *)(p), v)
+#define LOADD(p)	_mm256_loadu_pd ((double *)(p))
+#define STORED(p, v)	_mm256_storeu_pd ((double *)(p), v)
+
+/* these process the largest multiple of the vector width; the callers do the rest */
+AVX2_FN static int IntAddAVX2 (int32_t *dst, int32_t *a, int32_t *b, int n)
+{
+    int i = 0;
+    for (;  i + 8 <= n;  i += 8)
+	STOREI(dst + i, _mm256_add_epi32 (LOADI(a + i), LOADI(b + i)));
+    return i;
+}
+
+AVX2_FN static int IntSubAVX2 (int32_t *dst, int32_t *a, int32_t *b, int n)
+{
+    int i = 0;
+    for (;  i + 8 <= n;  i += 8)
+	STOREI(dst + i, _mm256_sub_epi32 (LOADI(a + i), LOADI(b + i)));
+    return i;
+}
+
+AVX2_FN static int IntMulAVX2 (int32_t *dst, int32_t *a, int32_t *b, int n)
+{
+    int i = 0;
+    for (;  i + 8 <= n;  i += 8)
+	STOREI(dst + i, _mm256_mullo_epi32 (LOADI(a + i), LOADI(b + i)));
+    return i;
+}
+
+AVX2_FN static int DoubleAddAVX2 (double *dst, double *a, double *b, int n)
+{
+    int i = 0;
+    for (;  i + 4 <= n;  i += 4)
+	STORED(dst + i, _mm256_add_pd (LOADD(a + i), LOADD(b + i)));
+    return i;
+}
+
+AVX2_FN static int DoubleSubAVX2 (double *dst, double *a, double *b, int n)
+{
+    int i = 0;
+    for (;  i + 4 <= n;  i += 4)
+	STORED(dst + i, _mm256_sub_pd (LOADD(a + i), LOADD(b + i)));
+    return i;
+}
+
+AVX2_FN static int DoubleMulAVX2 (double *dst, double *a, double *b, int n)
+{
+    int i = 0;
+    for (;  i + 4 <= n;  i += 4)
+	STORED(dst + i, _mm256_mul_pd (LOADD(a + i), LOADD(b + i)));
+    return i;
+}
+
+AVX2_FN static int DoubleScaleAVX2 (double *dst, double *a, double s, int n)
+{
+    __m256d v = _mm256_set1_pd (s);
+    int i = 0;
+    for (;  i + 4 <= n;  i += 4)
+	STORED(dst + i, _mm256_mul_pd (LOADD(a + i), v));
+    return i;
+}
+
+#endif /* HAVE_AVX2_KERNELS */
+
+/********** Entry points **********/
+
+#ifdef HAVE_AVX2_KERNELS
+#  define DISPATCH(AVX2, SCALAR)	(UseAVX2 ? (AVX2) : (SCALAR))
+#  define VEC_PREFIX(CALL)		(UseAVX2 ? (CALL) : 0)
+#else
+#  define DISPATCH(AVX2, SCALAR)	(SCALAR)
+#  define VEC_PREFIX(CALL)		0
+#endif
+
+int32_t M_IntSum (int32_t *a, int n)
+{
+    return DISPATCH(IntSumAVX2(a, n), IntSumScalar(a, n));
+}
+
+int32_t M_IntMin (int32_t *a, int n)
+{
+    return DISPATCH(IntMinAVX2(a, n), IntMinScalar(a, n));
+}
+
+int32_t M_IntMax (int32_t *a, int n)
+{
+    return DISPATCH(IntMaxAVX2(a, n), IntMaxScalar(a, n));
+}
+
+int32_t M_IntDot (int32_t *a, int32_t *b, int n)
+{
+    return DISPATCH(IntDotAVX2(a, b, n), IntDotScalar(a, b, n));
+}
+
+double M_DoubleSum (double *a, int n)
+{
+    return DISPATCH(DoubleSumAVX2(a, n), DoubleSumScalar(a, n));
+}
+
+double M_DoubleMin (double *a, int n)
+{
+    return DISPATCH(DoubleMinAVX2(a, n), DoubleMinScalar(a, n));
+}
+
+double M_DoubleMax (double *a, int n)
+{
+    return DISPATCH(DoubleMaxAVX2(a, n), DoubleMaxScalar(a, n));
+}
+
+double M_DoubleDot (double *a, double *b, int n)
+{
+    return DISPATCH(DoubleDotAVX2(a, b, n), DoubleDotScalar(a, b, n));
+}
+
+int32_t M_IntPrefixSum (int32_t *dst, int32_t *a, int n, int32_t init)
+{
+    return DISPATCH(IntPrefixSumAVX2(dst, a, n, init), IntPrefixSumScalar(dst, a, n, init));
+}
+
+double M_DoublePrefixSum (double *dst, double *a, int n, double init)
+{
+    double s = init;
+    for (int i = 0;  i < n;  i++) {
+	double x = a[i];
+	dst[i] = s;
+	s += x;
+    }
+    return s;
+}
+
+void M_IntAdd (int32_t *dst, int32_t *a, int32_t *b, int n)
+{
+    for (int i = VEC_PREFIX(IntAddAVX2(dst, a, b, n));  i < n;  i++)
+	dst[i] = (int32_t)((uint32_t)a[i] + (uint32_t)b[i]);
+}
+
+void M_IntSub (int32_t *dst, int32_t *a, int32_t *b, int n)
+{
+    for (int i = VEC_PREFIX(IntSubAVX2(dst, a, b, n));  i < n;  i++)
+	dst[i] = (int32_t)((uint32_t)a[i] - (uint32_t)b[i]);
+}
+
+void M_IntMul (int32_t *dst, int32_t *a, int32_t *b, int n)
+{
+    for (int i = VEC_PREFIX(IntMulAVX2(dst, a, b, n));  i < n;  i++)
+	dst[i] = (int32_t)((uint32_t)a[i] * (uint32_t)b[i]);
+}
+
+void M_DoubleAdd (double *dst, double *a, double *b, int n)
+{
+    for (int i = VEC_PREFIX(DoubleAddAVX2(dst, a, b, n));  i < n;  i++)
+	dst[i] = a[i] + b[i];
+}
+
+void M_DoubleSub (double *dst, double *a, double *b, int n)
+{
+    for (int i = VEC_PREFIX(DoubleSubAVX2(dst, a, b, n));  i < n;  i++)
+	dst[i] = a[i] - b[i];
+}
+
+void M_DoubleMul (double *dst, double *a, double *b, int n)
+{
+    for (int i = VEC_PREFIX(DoubleMulAVX2(dst, a, b, n));  i < n;  i++)
+	dst[i] = a[i] * b[i];
+}
+
+void M_DoubleScale (double *dst, double *a, double s, int n)
+{
+    for (int i = VEC_PREFIX(DoubleScaleAVX2(dst, a, s, n));  i < n;  i++)
+	dst[i] = a[i] * s;
+}
@@ -12,6 +12,7 @@
 #include "scheduler.h"
 #include "heap.h"
 #include "event-log.h"
+#include "elastic.h"
 
 extern RequestCode_t ASM_Apply (VProc_t *vp, Addr_t cp, Value_t arg, Value_t ep, Value_t rk, Value_t ek);
 extern int ASM_Return;
@@ -139,10 +140,13 @@ void RunManticore (VProc_t *vp, Addr_t codeP, Value_t arg, Value_t envP)
 	    {
 	       Value_t status = M_TRUE;
 	       Time_t timeToSleep = *((Time_t*)(vp->stdArg));
-	       if (timeToSleep == 0)    /* convention: if timeToSleep == 0, sleep indefinitely */
-		   VProcSleep(vp);
-	       else
-		   status = VProcNanosleep(vp, timeToSleep);
+	     /* a vproc that parks instead of sleeping gets its status from VProcParkIfIdle */
+	       if (! VProcParkIfIdle(vp, timeToSleep, &status)) {
+		   if (timeToSleep == 0)    /* convention: if timeToSleep == 0, sleep indefinitely */
+		       VProcSleep(vp);
+		   else
+		       status = VProcNanosleep(vp, timeToSleep);
+	       }
 	       assert (vp->wakeupCont != M_NIL);
 	       envP = vp->wakeupCont;
 	       codeP = ValueToAddr (ValueToCont(envP)->cp);
@@ -0,0 +1,269 @@
+/* elastic.c
+ *
+ * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
+ * All rights reserved.
+ *
+ * Parking and unparking of vprocs (see elastic.h).  The idleness policy runs in
+ * the PingLoop thread: once per time quantum it samples which of the active vprocs
+ * are sleeping.  At the end of each window, a vproc that was sleeping for at least
+ * PARK_IDLE_PCT percent of the samples is asked to park the next time that it goes
+ * to sleep.  When every active vproc has been busy for UNPARK_BUSY_TICKS quanta in
+ * a row, the lowest-numbered parked vproc is unparked.
+ */
+
+#include "manticore-rt.h"
+#include <sys/time.h>
+#include "options.h"
+#include "value.h"
+#include "vproc.h"
+#include "heap.h"
+#include "gc.h"
+#include "topology.h"
+#include "atomic-ops.h"
+#include "work-stealing-deque.h"
+#include "event-log.h"
+#include "perf.h"
+#include "elastic.h"
+
+typedef struct {
+    volatile bool	parkReq;	// set by the policy to ask the vproc to park
+    int			nIdle;		// number of samples in the window in which the
+					// vproc was sleeping
+    int			nParks;		// number of times that the vproc has parked
+} Elastic_t;
+
+static bool		ElasticFlg;		// true if the idleness policy is enabled
+static int		TimeQMS;		// the time quantum in milliseconds
+static int		WindowTicks;		// length of the idleness window in quanta
+static volatile int	TargetActive = MAX_NUM_VPROCS;
+						// target number of active vprocs
+static Elastic_t	Elastic[MAX_NUM_VPROCS];
+
+static void UnparkVProc (VProc_t *vp);
+
+void InitElastic (Options_t *opts, int timeQ)
+{
+    ElasticFlg = GetFlagOpt (opts, "-elastic");
+    int parkAfter = GetIntOpt (opts, "-parkafter", DFLT_PARK_AFTER_MS);
+
+    TimeQMS = (timeQ > 0) ? timeQ : 1;
+    WindowTicks = parkAfter / TimeQMS;
+    if (WindowTicks < 1)
+	WindowTicks = 1;
+
+}
+
+/* can the vproc be parked?  The lowest-numbered vproc on each node must stay
+ * active and we do not park a vproc that still has work in its deques.
+ */
+STATIC_INLINE bool CanPark (VProc_t *vp)
+{
+    return (vp->id != MinVProcPerNode[LocationNode(vp->location)])
+	&& (M_NumDequeRoots(vp) == 0);
+}
+
+Value_t **ParkedVProcRoots (VProc_t *vp, Value_t **rp)
+{
+  /* these are the same fields that the minor GC uses as roots */
+    *rp++ = &(vp->currentFLS);
+    *rp++ = &(vp->actionStk);
+    *rp++ = &(vp->schedCont);
+    *rp++ = &(vp->dummyK);
+    *rp++ = &(vp->wakeupCont);
+    *rp++ = &(vp->shutdownCont);
+    *rp++ = &(vp->rdyQHd);
+    *rp++ = &(vp->rdyQTl);
+    *rp++ = &(vp->sndQHd);
+    *rp++ = &(vp->sndQTl);
+    *rp++ = &(vp->landingPad);
+    *rp++ = &(vp->stdEnvPtr);
+    rp = M_AddDequeEltsToLocalRoots(vp, rp);
+    *rp = 0;
+
+    return rp;
+
+}
+
+bool VProcParkIfIdle (VProc_t *vp, Time_t nsec, Value_t *status)
+{
+    Elastic_t *e = &(Elastic[vp->id]);
+
+    assert (vp == VProcSelf());
+
+    if ((vp->id < TargetActive) && !e->parkReq)
+	return false;
+    if (! CanPark(vp)) {
+	e->parkReq = false;
+	return false;
+    }
+
+  /* promote everything that is reachable from the vproc's roots, which leaves
+   * the local heap empty.
+   */
+    Value_t *roots[NUM_PARKED_ROOTS + M_NumDequeRoots(vp) + 1];
+    ParkedVProcRoots (vp, roots);
+    for (int i = 0;  roots[i] != 0;  i++)
+	*roots[i] = PromoteObj (vp, *roots[i]);
+    vp->stdArg = M_UNIT;
+    vp->stdExnCont = M_UNIT;
+    vp->oldTop = vp->heapBase;
+    SetAllocPtr (vp);
+
+  /* withdraw from global GC; if a global GC has already started, then we need
+   * to take part in it, so we go to sleep in the normal way.
+   */
+    if (! GlobalGCParkVProc (vp))
+	return false;
+
+#ifndef NDEBUG
+    if (DebugFlg)
+	SayDebug("[%2d] parked\n", vp->id);
+#endif
+
+  /* a timed sleep must still end at its deadline, since the vproc may not be
+   * unparked by the policy for a long time.
+   */
+    struct timespec timeToWake;
+    if (nsec > 0) {
+	struct timeval t;
+	gettimeofday (&t, 0);
+	uint64_t wakeNSec = (uint64_t)t.tv_usec * 1000 + nsec;
+	timeToWake.tv_sec = t.tv_sec + wakeNSec / 1000000000;
+	timeToWake.tv_nsec = wakeNSec % 1000000000;
+    }
+
+    LogVProcSleep (vp);
+#ifdef ENABLE_PERF_COUNTERS
+    PERF_PushPhase (vp, PERF_IDLE);
+#endif
+    int sts = 0;
+    MutexLock(&(vp->lock));
+	AtomicWriteValue (&(vp->sleeping), M_TRUE);
+	while ((vp->landingPad == M_NIL) && !vp->unparkReq) {
+	    if (nsec == 0)
+		CondWait (&(vp->wait), &(vp->lock));
+	  /* nonzero status indicates an OS interrupt or timeout */
+	    else if ((sts = CondTimedWait (&(vp->wait), &(vp->lock), &timeToWake)) != 0)
+		break;
+	}
+	AtomicWriteValue (&(vp->sleeping), M_FALSE);
+	vp->unparkReq = false;
+    MutexUnlock(&(vp->lock));
+#ifdef ENABLE_PERF_COUNTERS
+    PERF_PopPhase (vp);
+#endif
+
+  /* rejoin the global GC (this call waits for any GC that is in progress) */
+    GlobalGCUnparkVProc (vp);
+    e->parkReq = false;
+    e->nParks++;
+
+    *status = ManticoreBool (sts == 0);
+
+#ifndef NDEBUG
+    if (DebugFlg)
+	SayDebug("[%2d] unparked\n", vp->id);
+#endif
+
+    return true;
+
+}
+
+void ElasticTick ()
+{
+    static uint64_t	lastTick = 0;
+    static int		nTicks = 0;
+    static int		nBusyTicks = 0;
+
+    if (! ElasticFlg)
+	return;
+
+  /* the PingLoop may wake up more than once per quantum */
+    uint64_t now = TIMER_Now();
+    if (now - lastTick < 1000000 * (uint64_t)TimeQMS)
+	return;
+    lastTick = now;
+
+  /* sample the active vprocs */
+    int nActive = 0, nBusy = 0;
+    for (int i = 0;  i < NumVProcs;  i++) {
+	VProc_t *vp = VProcs[i];
+	if (vp->parked)
+	    continue;
+	nActive++;
+	if (vp->sleeping == M_TRUE)
+	    Elastic[i].nIdle++;
+	else
+	    nBusy++;
+    }
+
+  /* at the end of the window, ask the mostly-idle vprocs to park */
+    if (++nTicks == WindowTicks) {
+	for (int i = 0;  i < NumVProcs;  i++) {
+	    Elastic_t *e = &(Elastic[i]);
+	    if (! VProcs[i]->parked && (100 * e->nIdle >= PARK_IDLE_PCT * WindowTicks))
+		e->parkReq = true;
+	    e->nIdle = 0;
+	}
+	nTicks = 0;
+    }
+
+  /* if all of the active vprocs are busy, then bring one more into play */
+    if (nBusy == nActive) {
+	if (++nBusyTicks >= UNPARK_BUSY_TICKS) {
+	    for (int i = 0;  (i < NumVProcs) && (i < TargetActive);  i++) {
+		if (VProcs[i]->parked) {
+		    UnparkVProc (VProcs[i]);
+		    break;
+		}
+	    }
+	    nBusyTicks = 0;
+	}
+    }
+    else
+	nBusyTicks = 0;
+
+}
+
+/* wake a parked vproc */
+static void UnparkVProc (VProc_t *vp)
+{
+    MutexLock(&(vp->lock));
+	vp->unparkReq = true;
+	CondSignal (&(vp->wait));
+    MutexUnlock(&(vp->lock));
+
+}
+
+void M_SetNumActiveVProcs (int n)
+{
+    if (n < 1)
+	n = 1;
+    else if (n > NumVProcs)
+	n = NumVProcs;
+    TargetActive = n;
+
+  /* the vprocs at or above the target park the next time that they are idle */
+    for (int i = 0;  i < n;  i++) {
+	Elastic[i].parkReq = false;
+	if (VProcs[i]->parked)
+	    UnparkVProc (VProcs[i]);
+    }
+
+}
+
+int M_GetNumActiveVProcs ()
+{
+    int n = 0;
+    for (int i = 0;  i < NumVProcs;  i++) {
+	if (! VProcs[i]->parked)
+	    n++;
+    }
+    return n;
+
+}
+
+int M_VProcIsParked (VProc_t *vp)
+{
+    return vp->parked ? 1 : 0;
+}
@@ -0,0 +1,240 @@
+/* preempt.c
+ *
+ * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
+ * All rights reserved.
+ *
+ * Per-vproc preemption timers.  Each vproc's host thread owns a CLOCK_MONOTONIC
+ * timer that delivers PREEMPT_SIG to that thread (and only that thread) once per
+ * time quantum.  The timers of the vprocs are staggered across the quantum, so
+ * that the vprocs do not all enter the scheduler at the same time.  The handler
+ * only stores to the vproc's limit pointer, which is async-signal safe, and records
+ * the jitter of the tick, i.e., the difference between the observed and the
+ * expected interval between ticks.
+ */
+
+#include "manticore-rt.h"
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include <inttypes.h>
+#if defined(TARGET_LINUX)
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#endif
+#include "options.h"
+#include "value.h"
+#include "vproc.h"
+#include "heap.h"
+#include "event-log.h"
+#include "preempt.h"
+
+#define PREEMPT_SIG	SIGALRM
+
+#ifndef sigev_notify_thread_id
+#  define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+typedef struct {
+    volatile bool	enabled;	// true if timer preemption is enabled
+    bool		running;	// true if the timer has been created
+#if defined(TARGET_LINUX)
+    timer_t		timer;
+#endif
+    uint64_t		lastTick;	// time of the last tick (0 before the first one)
+    uint64_t		nTicks;		// number of ticks
+    uint64_t		nOverruns;	// number of ticks that were lost
+    uint64_t		totJitter;	// total jitter in nanoseconds
+    uint64_t		maxJitter;	// maximum jitter in nanoseconds
+} PreemptTimer_t;
+
+PreemptMode_t		PreemptMode;
+static long		TimeQNS;		// the time quantum in nanoseconds
+static bool		StatsFlg;		// true if we report jitter statistics
+static bool		WSNoPreemptFlg;		// true if work-stealing workers are not preempted
+static PreemptTimer_t	Timers[MAX_NUM_VPROCS];
+
+#if defined(TARGET_LINUX)
+static void PreemptHandler (int sig, siginfo_t *si, void *_uc);
+static void ArmTimer (VProc_t *vp, long firstNS);
+#endif
+
+void InitPreemption (Options_t *opts, int timeQ)
+{
+#if defined(TARGET_LINUX)
+    const char *dflt = "timer";
+#else
+    const char *dflt = "ping";
+#endif
+    const char *mode = GetStringOpt (opts, "-preempt", dflt);
+
+    if (strcmp(mode, "timer") == 0)
+	PreemptMode = PREEMPT_TIMER;
+    else if (strcmp(mode, "ping") == 0)
+	PreemptMode = PREEMPT_PING;
+    else if (strcmp(mode, "none") == 0)
+	PreemptMode = PREEMPT_NONE;
+    else {
+	Warning ("unknown preemption mode \"%s\"; using \"%s\"\n", mode, dflt);
+	mode = dflt;
+	PreemptMode = (strcmp(dflt, "timer") == 0) ? PREEMPT_TIMER : PREEMPT_PING;
+    }
+
+    StatsFlg = GetFlagOpt (opts, "-preemptstats");
+    WSNoPreemptFlg = GetFlagOpt (opts, "-ws-nopreempt");
+    TimeQNS = 1000000 * (long)timeQ;
+
+#if defined(TARGET_LINUX)
+    if (PreemptMode == PREEMPT_TIMER) {
+	struct sigaction sa;
+	sa.sa_sigaction = PreemptHandler;
+	sa.sa_flags = SA_SIGINFO | SA_RESTART;
+	sigfillset (&(sa.sa_mask));
+	sigaction (PREEMPT_SIG, &sa, 0);
+    }
+#else
+    if (PreemptMode == PREEMPT_TIMER) {
+	Warning ("per-vproc timers are not supported on this platform\n");
+	PreemptMode = PREEMPT_PING;
+    }
+#endif
+
+}
+
+void PreemptStartVProc (VProc_t *vp)
+{
+    PreemptTimer_t *t = &(Timers[vp->id]);
+
+    t->enabled = true;
+    if (PreemptMode != PREEMPT_TIMER)
+	return;
+
+#if defined(TARGET_LINUX)
+    struct sigevent sev;
+    memset (&sev, 0, sizeof(sev));
+    sev.sigev_notify = SIGEV_THREAD_ID;
+    sev.sigev_signo = PREEMPT_SIG;
+    sev.sigev_value.sival_ptr = vp;
+    sev.sigev_notify_thread_id = syscall(SYS_gettid);
+    if (timer_create (CLOCK_MONOTONIC, &sev, &(t->timer)) < 0) {
+	Die ("unable to create preemption timer for vproc %d; errno = %d\n", vp->id, errno);
+    }
+    t->running = true;
+
+  /* stagger the first tick of the vprocs across the quantum */
+    ArmTimer (vp, TimeQNS + (TimeQNS / NumVProcs) * vp->id);
+#endif
+
+}
+
+void VProcSetPreemption (VProc_t *vp, bool enable)
+{
+    PreemptTimer_t *t = &(Timers[vp->id]);
+
+    if (t->enabled == enable)
+	return;
+    t->enabled = enable;
+
+#if defined(TARGET_LINUX)
+    if (t->running) {
+	t->lastTick = 0;
+	ArmTimer (vp, enable ? TimeQNS : 0);
+    }
+#endif
+
+}
+
+/* M_WorkStealingWorkerInit:
+ *
+ * Called by a work-stealing worker when it starts on a vproc.  The workers
+ * only run short tasks and yield when their deque is empty, so with -ws-nopreempt
+ * we turn off the vproc's timer.
+ */
+void M_WorkStealingWorkerInit (VProc_t *vp)
+{
+    if (WSNoPreemptFlg)
+	VProcSetPreemption (vp, false);
+
+}
+
+void ReportPreemptStats ()
+{
+    if (! StatsFlg)
+	return;
+
+    Say ("preemption: mode = %s, quantum = %ld us\n",
+	(PreemptMode == PREEMPT_TIMER) ? "timer" : (PreemptMode == PREEMPT_PING) ? "ping" : "none",
+	TimeQNS / 1000);
+    if (PreemptMode != PREEMPT_TIMER)
+	return;
+
+    Say ("  vp      ticks   overruns  mean jitter (us)   max jitter (us)\n");
+    for (int i = 0;  i < NumVProcs;  i++) {
+	PreemptTimer_t *t = &(Timers[i]);
+	uint64_t nIntervals = (t->nTicks > 1) ? t->nTicks - 1 : 1;
+	Say ("  %2d %10" PRIu64 " %10" PRIu64 " %18.1f %17.1f%s\n",
+	    i, t->nTicks, t->nOverruns,
+	    (double)t->totJitter / (double)nIntervals / 1000.0,
+	    (double)t->maxJitter / 1000.0,
+	    t->enabled ? "" : "  (disabled)");
+    }
+
+}
+
+#if defined(TARGET_LINUX)
+/* ArmTimer:
+ *
+ * Set the vproc's timer to first expire after firstNS nanoseconds and then once
+ * per quantum.  If firstNS is zero, the timer is disarmed.
+ */
+static void ArmTimer (VProc_t *vp, long firstNS)
+{
+    struct itimerspec its;
+
+    its.it_value.tv_sec = firstNS / 1000000000L;
+    its.it_value.tv_nsec = firstNS % 1000000000L;
+    if (firstNS == 0) {
+	its.it_interval = its.it_value;
+    }
+    else {
+	its.it_interval.tv_sec = TimeQNS / 1000000000L;
+	its.it_interval.tv_nsec = TimeQNS % 1000000000L;
+    }
+    timer_settime (Timers[vp->id].timer, 0, &its, 0);
+
+}
+
+static void PreemptHandler (int sig, siginfo_t *si, void *_uc)
+{
+    VProc_t *vp = (VProc_t *)si->si_value.sival_ptr;
+    if (vp == 0)
+	return;
+
+    PreemptTimer_t *t = &(Timers[vp->id]);
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    uint64_t now = 1000000000ull * (uint64_t)ts.tv_sec + (uint64_t)ts.tv_nsec;
+
+  /* update the jitter statistics */
+    int overrun = timer_getoverrun (t->timer);
+    if (overrun > 0)
+	t->nOverruns += overrun;
+    if (t->lastTick != 0) {
+	uint64_t expected = (uint64_t)TimeQNS * (uint64_t)(1 + ((overrun > 0) ? overrun : 0));
+	uint64_t delta = now - t->lastTick;
+	uint64_t jitter = (delta > expected) ? delta - expected : expected - delta;
+	t->totJitter += jitter;
+	if (jitter > t->maxJitter)
+	    t->maxJitter = jitter;
+    }
+    t->lastTick = now;
+    t->nTicks++;
+
+    if (t->enabled && (vp->sleeping != M_TRUE)) {
+	LogPreemptVProc (vp, vp->id);
+	SetLimitPtr (vp, 0);
+    }
+
+}
+#endif
@@ -9,13 +9,11 @@
 #include <signal.h>
 #include <time.h>
 #include <sys/time.h>
-#if defined (TARGET_DARWIN)
-#  include <sys/sysctl.h>
-#endif
 #include <errno.h>
 #include <inttypes.h>
 #include "os-memory.h"
 #include "os-threads.h"
+#include "spin-barrier.h"
 #include "atomic-ops.h"
 #include "topology.h"
 #include "vproc.h"
@@ -28,6 +26,9 @@
 #include "log-file.h"
 #include "time.h"
 #include "perf.h"
+#include "profile.h"
+#include "alloc-prof.h"
+#include "preempt.h"
 #include "work-stealing-deque.h"
 
 typedef struct {	    /* data passed to NewVProc */
@@ -42,12 +43,11 @@ static void *NewVProc (void *_data);
 static void MainVProc (VProc_t *vp, void *arg);
 static void IdleVProc (VProc_t *vp, void *arg);
 static void SigHandler (int sig, siginfo_t *si, void *_sc);
-static int GetNumCPUs ();
 
 static pthread_key_t	VProcInfoKey;
 
-static Barrier_t	InitBarrier;	/* barrier for initialization */
-static Barrier_t	ShutdownBarrier; /* barrier for shutdown */
+static SpinBarrier_t	InitBarrier;	/* barrier for initialization */
+static SpinBarrier_t	ShutdownBarrier; /* barrier for shutdown */
 
 /********** Globals **********/
 int			NumVProcs;
@@ -88,7 +88,7 @@ void VProcInit (bool isSequential, Options_t *opts)
 	NumVProcs = 1;
     }
     else {
-	NumVProcs = ((NumHWThreads == 0) ? DFLT_NUM_VPROCS : NumHWThreads);
+	NumVProcs = ((NumUsableCPUs == 0) ? DFLT_NUM_VPROCS : NumUsableCPUs);
     NumVProcs = GetVprocsOpt (opts, NumVProcs, &procs);
 	NumVProcs = GetIntOpt (opts, "-p", NumVProcs);
 	if ((NumHWThreads > 0) && (NumVProcs > NumHWThreads))
@@ -127,9 +127,12 @@ void VProcInit (bool isSequential, Options_t *opts)
   /* Initialize the work stealing scheduler-local data */
     M_InitWorkGroupList ();
 
+  /* now that we know the number of vprocs, bound the initial to-space size */
+    InitToSpaceLimit ();
+
   /* Initialize vprocs */
-    BarrierInit (&InitBarrier, NumVProcs+1);
-    BarrierInit (&ShutdownBarrier, NumVProcs);
+    SpinBarrierInit (&InitBarrier, NumVProcs+1);
+    SpinBarrierInit (&ShutdownBarrier, NumVProcs);
 
     InitData_t *initData = NEWVEC(InitData_t, NumVProcs);
     initData[0].id = 0;
@@ -160,37 +163,12 @@ void VProcInit (bool isSequential, Options_t *opts)
 	for (int i = 0;  i < NumVProcs;  i++)
 	    initData[i].loc = Locations[i%NumHWThreads];
     }
-    else if (NumVProcs <= NumHWNodes) {
-      /* at most one vproc per node */
-	for (int nd = 0;  nd < NumVProcs;  nd++)
-	    initData[nd].loc = Location(nd, 0, 0);
-    }
-    else if (NumVProcs <= NumHWCores) {
-      /* at most one vproc per core */
-	int nd = 0;
-	int core = 0;
-	for (int i = 0;  i < NumVProcs;  i++) {
-	    initData[i].loc = Location(nd, core, 0);
-	    if (++nd == NumHWNodes) {
-		nd = 0;
-		core++;
-	    }
-	}
-    }
     else {
-	int nd = 0;
-	int core = 0;
-	int thd = 0;
-	for (int i = 0;  i < NumVProcs;  i++) {
-	    initData[i].loc = Location(nd, core, thd);
-	    if (++nd == NumHWNodes) {
-		nd = 0;
-		if (++core == NumCoresPerNode) {
-		    core = 0;
-		    thd++;
-		}
-	    }
-	}
+      /* spread the vprocs across the nodes first, then the cores, and then the
+       * hardware threads.
+       */
+	for (int i = 0;  i < NumVProcs;  i++)
+	    initData[i].loc = SpreadLocations[i];
     }
 
     for (int i = 0;  i < NumVProcs;  i++) {
@@ -208,7 +186,7 @@ void VProcInit (bool isSequential, Options_t *opts)
 	    Die ("Unable to start vproc %d\n", i);
     }
 
-    BarrierWait (&InitBarrier);
+    SpinBarrierWait (&InitBarrier, 0);
 
     FREE (initData);
 
@@ -274,6 +252,8 @@ void *NewVProc (void *arg)
     vproc->atomic = M_TRUE;
     vproc->sigPending = M_FALSE;
     vproc->sleeping = M_FALSE;
+    vproc->parked = false;
+    vproc->unparkReq = false;
     vproc->actionStk = M_NIL;
     vproc->schedCont = M_NIL;
     vproc->dummyK = M_NIL;
@@ -304,6 +284,9 @@ void *NewVProc (void *arg)
 #if defined (TARGET_LINUX) && defined (ENABLE_PERF_COUNTERS)
     InitPerfCounters (vproc);
 #endif 
+    ProfStartVProc (vproc);
+    AllocProfStartVProc (vproc);
+    PreemptStartVProc (vproc);
 
 #ifndef NO_GC_STATS
     vproc->nPromotes = 0;
@@ -323,6 +306,8 @@ void *NewVProc (void *arg)
     TIMER_Init (&(vproc->globalStats.timer));
     vproc->nBytesPromoted = 0;
     TIMER_Init (&(vproc->promoteTimer));
+    vproc->nGCBarriers = 0;
+    TIMER_Init (&(vproc->gcBarrierTimer));
 #endif
 
   /* store a pointer to the VProc info as thread-specific data */
@@ -335,7 +320,7 @@ void *NewVProc (void *arg)
     Value_t initArg = initData->initArg;
 
   /* Wait until all vprocs have been initialized */
-    BarrierWait (&InitBarrier);
+    SpinBarrierWait (&InitBarrier, 0);
 
   /* start the timer */
     TIMER_Start (&(vproc->timer));
@@ -368,7 +353,7 @@ void VProcExit (VProc_t *vp)
 	    vp->id, TIMER_GetTime(&(vp->timer)));
 #endif
 
-    BarrierWait(&ShutdownBarrier);
+    SpinBarrierWait (&ShutdownBarrier, 0);
 
     if (vp == VProcs[0]) {
       /* assign vproc 0 to finalize the runtime state */
@@ -382,6 +367,10 @@ void VProcExit (VProc_t *vp)
     ReportPerfCounters ();
 #endif 
 
+	WriteProfile ();
+	WriteAllocProf ();
+	ReportPreemptStats ();
+
 #ifndef NO_GC_STATS
 	ReportGCStats ();
 #endif
@@ -505,12 +494,18 @@ void VProcSleep (VProc_t *vp)
 	SayDebug("[%2d] VProcSleep called\n", vp->id);
 #endif
 
+#ifdef ENABLE_PERF_COUNTERS
+    PERF_PushPhase (vp, PERF_IDLE);
+#endif
     MutexLock(&(vp->lock));
 	AtomicWriteValue (&(vp->sleeping), M_TRUE);
 	while (vp->landingPad == M_NIL)
 	    CondWait (&(vp->wait), &(vp->lock));
 	AtomicWriteValue (&(vp->sleeping), M_FALSE);
     MutexUnlock(&(vp->lock));
+#ifdef ENABLE_PERF_COUNTERS
+    PERF_PopPhase (vp);
+#endif
 
 #ifndef NDEBUG
     if (DebugFlg)
@@ -565,6 +560,9 @@ Value_t VProcNanosleep (VProc_t *vp, Time_t nsec)
 // wall clock time indicating when the vproc should wake
     struct timespec timeToWake = TimespecAdd (delta, currTime);
 
+#ifdef ENABLE_PERF_COUNTERS
+    PERF_PushPhase (vp, PERF_IDLE);
+#endif
     MutexLock (&(vp->lock));
 // QUESTION: do we really need an AtomicWriteValue here, since we are inside a lock?
 	AtomicWriteValue (&(vp->sleeping), M_TRUE);
@@ -574,6 +572,9 @@ Value_t VProcNanosleep (VProc_t *vp, Time_t nsec)
 	    continue;
 	AtomicWriteValue (&(vp->sleeping), M_FALSE);
     MutexUnlock (&(vp->lock));
+#ifdef ENABLE_PERF_COUNTERS
+    PERF_PopPhase (vp);
+#endif
 
 #ifndef NDEBUG
     if (DebugFlg) {
@@ -621,41 +622,6 @@ static void IdleVProc (VProc_t *vp, void *arg)
     assert (0);
 }
 
-static int GetNumCPUs ()
-{
-#if defined(HAVE__PROC_CPUINFO)
-  /* Get the number of hardware processors on systems that have /proc/cpuinfo */
-    FILE *cpuinfo = fopen("/proc/cpuinfo", "r");
-    char buf[1024];
-    if (cpuinfo != NULL) {
-	int n = 0;
-	while (fgets(buf, sizeof(buf), cpuinfo) != 0) {
-	    int id;
-	    if (sscanf(buf, "processor : %d", &id) == 1)
-		n++;
-	}
-	fclose (cpuinfo);
-	return n;
-    }
-    else {
-	Warning("unable to determine the number of processors\n");
-	return 0;
-    }
-#elif defined(TARGET_DARWIN)
-    int		numCPUs;
-    size_t	len = sizeof(int);
-    if (sysctlbyname("hw.activecpu", &numCPUs, &len, 0, 0) < 0) {
-	Warning("unable to determine the number of processors\n");
-	return 0;
-    }
-    else
-	return numCPUs;
-#else
-    return 0;
-#endif
-
-} /* end of GetNumCPUs */
-
 
 /***** Exported VProc operations *****
  *
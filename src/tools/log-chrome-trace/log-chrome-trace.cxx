@@ -0,0 +1,594 @@
+/* log-chrome-trace.cxx
+ *
+ * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
+ * All rights reserved.
+ *
+ * Converts a log file to the Chrome Trace Event JSON format, which can be viewed
+ * with chrome://tracing or the Perfetto UI (ui.perfetto.dev).  The structure of the
+ * trace comes from the log-view.json file:
+ *   - each vproc is a thread track, on which interval groups are shown as slices
+ *     and the other events as instants;
+ *   - each state group gets an additional track per vproc, on which the states are
+ *     shown as slices;
+ *   - dependent groups are shown as flow arrows from the source to the destination
+ *     event, matched on the source's new-id argument.
+ *
+ * The events are merged from the per-vproc buffers of the mapped log file and written
+ * as they are merged, so memory use is proportional to the number of buffers (not the
+ * number of events) plus the number of open intervals.
+ */
+
+//#include "manticore-config.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <queue>
+#include <algorithm>
+#include "log-file.h"
+#include "event-desc.hxx"
+#include "log-desc.hxx"
+#include "log-index.hxx"
+#include "default-log-paths.h"
+
+#define logDescFile	DEFAULT_LOG_EVENTS_PATH
+#define logViewFile	DEFAULT_LOG_VIEW_PATH
+
+/* the actual size of a block in the log buffer */
+static size_t	LogBufSzB = LOGBLOCK_SZB;
+static int	NEventsPerBuf = LOGBUF_SZ;
+
+/* the process ID used for all of the tracks */
+#define TRACE_PID	1
+
+/* a cursor into the events of a vproc */
+struct VProcCursor {
+    int32_t		vpId;
+    std::vector<LogBuffer_t *> bufs;	// the vproc's buffers in sequence order
+    unsigned int	buf;		// the current buffer
+    int			next;		// the next event in the current buffer
+    uint64_t		timestamp;	// the timestamp of the next event
+
+  // return the next event (0 if there are no more)
+    LogEvent_t *Peek () const
+    {
+	return (this->buf < this->bufs.size()) ? &(this->bufs[this->buf]->log[this->next]) : 0;
+    }
+};
+
+/* order cursors so that the priority queue yields the earliest event first */
+struct LaterCursor {
+    bool operator() (VProcCursor *c1, VProcCursor *c2) const
+    {
+	if (c1->timestamp != c2->timestamp)
+	    return (c1->timestamp > c2->timestamp);
+	else
+	    return (c1->vpId > c2->vpId);
+    }
+};
+
+/* an open interval */
+struct OpenInterval {
+    uint64_t		start;		// timestamp of the start event
+    LogEvent_t		*evt;		// the start event (for its arguments)
+};
+
+typedef std::pair<int32_t, IntervalGroup *> IntervalKey_t;
+
+LogFileHeader_t		*Hdr;		/* the file's header */
+int			NumEvents;	/* number of events */
+
+static LogFileDesc	*LogDesc;
+static std::vector<StateGroup *> StateGrps;	/* the state groups in pre-order */
+static std::map<IntervalKey_t, std::vector<OpenInterval> > OpenIntervals;
+static int		*CurState;	/* current state per (state group, vproc) */
+static uint64_t		*StateStart;	/* start of the current state per (state group, vproc) */
+static bool		First = true;	/* true until the first trace event is written */
+
+static inline uint64_t GetTimestamp (LogTS_t *ts);
+static std::vector<VProcCursor *> *OpenLogFile (const char *file, char **base, off_t *fileSize);
+static void FindStateGroups ();
+static void ConvertEvent (FILE *out, int32_t vpId, uint64_t ts, LogEvent_t *lp);
+static void FinishTrace (FILE *out, uint64_t endTime);
+static void PrintMetadata (FILE *out);
+static void Usage (int sts);
+
+int main (int argc, const char **argv)
+{
+    const char *logFile = DFLT_LOG_FILE;
+    FILE *out = stdout;
+
+  // process args
+    for (int i = 1;  i < argc; ) {
+	if (strcmp(argv[i], "-h") == 0) {
+	    Usage (0);
+	}
+	else if (strcmp(argv[i], "-o") == 0) {
+	    if (++i < argc) {
+		out = fopen(argv[i], "w"); i++;
+		if (out == NULL) {
+		    perror("fopen");
+		    exit(1);
+		}
+	    }
+	    else {
+		fprintf(stderr, "missing filename for \"-o\" option\n");
+		Usage (1);
+	    }
+	}
+	else if (strcmp(argv[i], "-log") == 0) {
+	    if (++i < argc) {
+		logFile = argv[i]; i++;
+	    }
+	    else {
+		fprintf(stderr, "missing filename for \"-log\" option\n");
+		Usage (1);
+	    }
+	}
+	else {
+	    fprintf(stderr, "invalid argument \"%s\"\n", argv[i]);
+	    Usage(1);
+	}
+    }
+
+    LogDesc = LoadLogDesc (logDescFile, logViewFile);
+    if (LogDesc == 0) {
+	fprintf(stderr, "unable to load \"%s\"\n", logDescFile);
+	exit (1);
+    }
+    FindStateGroups ();
+
+    char *base;
+    off_t fileSize;
+    std::vector<VProcCursor *> *cursors = OpenLogFile (logFile, &base, &fileSize);
+
+  /* the start of the run is the earlier of the header's start time and the first event */
+    uint64_t startTime = GetTimestamp (&(Hdr->startTime));
+    std::priority_queue<VProcCursor *, std::vector<VProcCursor *>, LaterCursor> pq;
+    for (unsigned int i = 0;  i < cursors->size();  i++) {
+	VProcCursor *c = cursors->at(i);
+	if (c->Peek() != 0) {
+	    if (c->timestamp < startTime)
+		startTime = c->timestamp;
+	    pq.push (c);
+	}
+    }
+
+    int nStates = StateGrps.size() * Hdr->nVProcs;
+    CurState = new int[nStates];
+    StateStart = new uint64_t[nStates];
+    for (unsigned int g = 0;  g < StateGrps.size();  g++) {
+	for (int vp = 0;  vp < Hdr->nVProcs;  vp++) {
+	    CurState[g * Hdr->nVProcs + vp] = StateGrps[g]->StartState();
+	    StateStart[g * Hdr->nVProcs + vp] = 0;
+	}
+    }
+
+    fprintf (out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    PrintMetadata (out);
+
+  /* merge the vproc event streams */
+    uint64_t endTime = 0;
+    NumEvents = 0;
+    while (! pq.empty()) {
+	VProcCursor *c = pq.top();
+	pq.pop();
+	uint64_t ts = c->timestamp - startTime;
+	ConvertEvent (out, c->vpId, ts, c->Peek());
+	endTime = ts;
+	NumEvents++;
+      // advance the cursor
+	if (++c->next >= c->bufs[c->buf]->next) {
+	    c->buf++;
+	    c->next = 0;
+	}
+	if (c->Peek() != 0) {
+	    c->timestamp = GetTimestamp (&(c->Peek()->timestamp));
+	    pq.push (c);
+	}
+    }
+
+    FinishTrace (out, endTime);
+    fprintf (out, "\n]}\n");
+
+    munmap (base, fileSize);
+
+}
+
+/***** JSON output *****/
+
+/* start a new element of the traceEvents array */
+static void StartEvent (FILE *out)
+{
+    if (First)
+	First = false;
+    else
+	fprintf (out, ",\n");
+}
+
+/* print a string as a JSON string literal */
+static void PrintString (FILE *out, const char *s)
+{
+    fputc ('"', out);
+    for (;  *s != '\0';  s++) {
+	switch (*s) {
+	  case '"': fputs ("\\\"", out); break;
+	  case '\\': fputs ("\\\\", out); break;
+	  case '\n': fputs ("\\n", out); break;
+	  case '\t': fputs ("\\t", out); break;
+	  default:
+	    if ((unsigned char)*s < 0x20)
+		fprintf (out, "\\u%04x", *s);
+	    else
+		fputc (*s, out);
+	}
+    }
+    fputc ('"', out);
+}
+
+/* print a timestamp in microseconds, which is the unit used by the trace format */
+static void PrintTS (FILE *out, const char *field, uint64_t ts)
+{
+    fprintf (out, ",\"%s\":%" PRIu64 ".%03d", field, ts / 1000, (int)(ts % 1000));
+}
+
+/* print the arguments of an event as an "args" object */
+static void PrintArgs (FILE *out, EventDesc *desc, LogEvent_t *lp)
+{
+    if (desc->NArgs() == 0)
+	return;
+
+    fprintf (out, ",\"args\":{");
+    for (int i = 0;  i < desc->NArgs();  i++) {
+	if (i > 0) fputc (',', out);
+	ArgDesc *ad = desc->GetArgDesc(i);
+	PrintString (out, ad->name);
+	fputc (':', out);
+	ArgValue v = desc->GetArg(lp, i);
+	switch (ad->ty) {
+	  case ADDR: fprintf (out, "\"%#" PRIx64 "\"", v.a); break;
+	  case INT: fprintf (out, "%d", v.i); break;
+	  case WORD: fprintf (out, "%u", v.w); break;
+	  case FLOAT: fprintf (out, "%g", (double)v.f); break;
+	  case DOUBLE: fprintf (out, "%g", v.d); break;
+	  case NEW_ID:
+	  case EVENT_ID: fprintf (out, "%" PRIu64, v.id); break;
+	  default: PrintString (out, v.str); break;
+	}
+    }
+    fputc ('}', out);
+
+}
+
+/* return the value of the first argument of the given type (0 if there is none) */
+static uint64_t GetIdArg (EventDesc *desc, LogEvent_t *lp, ArgType ty)
+{
+    for (int i = 0;  i < desc->NArgs();  i++) {
+	if (desc->GetArgType(i) == ty)
+	    return desc->GetArg(lp, i).id;
+    }
+    return 0;
+}
+
+/* the thread ID of the track for state group g of a vproc */
+static inline int StateTrack (int g, int vpId)
+{
+    return (g + 1) * Hdr->nVProcs + vpId;
+}
+
+/* print a complete slice */
+static void PrintSlice (FILE *out, const char *name, const char *cat, int tid,
+    uint64_t start, uint64_t end, EventDesc *desc, LogEvent_t *lp)
+{
+    StartEvent (out);
+    fprintf (out, "{\"name\":");
+    PrintString (out, name);
+    fprintf (out, ",\"cat\":");
+    PrintString (out, cat);
+    fprintf (out, ",\"ph\":\"X\",\"pid\":%d,\"tid\":%d", TRACE_PID, tid);
+    PrintTS (out, "ts", start);
+    PrintTS (out, "dur", end - start);
+    if (desc != 0)
+	PrintArgs (out, desc, lp);
+    fputc ('}', out);
+}
+
+/* print a flow event; ph is "s" for the source and "f" for the destination */
+static void PrintFlow (FILE *out, DependentGroup *grp, const char *ph, int tid, uint64_t ts, uint64_t id)
+{
+    StartEvent (out);
+    fprintf (out, "{\"name\":");
+    PrintString (out, grp->Desc());
+    fprintf (out, ",\"cat\":\"dependent\",\"ph\":\"%s\",\"pid\":%d,\"tid\":%d", ph, TRACE_PID, tid);
+    PrintTS (out, "ts", ts);
+    fprintf (out, ",\"id\":\"%#" PRIx64 "\"", id);
+    if (ph[0] == 'f')
+	fprintf (out, ",\"bp\":\"e\"");
+    fputc ('}', out);
+}
+
+/* name the tracks */
+static void PrintMetadata (FILE *out)
+{
+    StartEvent (out);
+    fprintf (out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"manticore (%s)\"}}",
+	TRACE_PID, Hdr->clockName);
+    for (int vp = 0;  vp < Hdr->nVProcs;  vp++) {
+	StartEvent (out);
+	fprintf (out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"vproc %d\"}}",
+	    TRACE_PID, vp, vp);
+	StartEvent (out);
+	fprintf (out, "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"sort_index\":%d}}",
+	    TRACE_PID, vp, vp * ((int)StateGrps.size() + 1));
+	for (unsigned int g = 0;  g < StateGrps.size();  g++) {
+	    int tid = StateTrack (g, vp);
+	    StartEvent (out);
+	    fprintf (out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":",
+		TRACE_PID, tid);
+	    char buf[32];
+	    snprintf (buf, sizeof(buf), "vproc %d: ", vp);
+	    std::string name = std::string(buf) + StateGrps[g]->Desc();
+	    PrintString (out, name.c_str());
+	    fprintf (out, "}}");
+	    StartEvent (out);
+	    fprintf (out, "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"sort_index\":%d}}",
+		TRACE_PID, tid, vp * ((int)StateGrps.size() + 1) + (int)g + 1);
+	}
+    }
+}
+
+/***** Event conversion *****/
+
+/* ConvertEvent:
+ *
+ * Write the trace events for a single log event.  Intervals are written as complete
+ * slices when their end event is seen; state slices are written when the state
+ * changes.
+ */
+static void ConvertEvent (FILE *out, int32_t vpId, uint64_t ts, LogEvent_t *lp)
+{
+    EventDesc *desc = LogDesc->FindEventById (lp->event);
+    bool shown = false;
+
+  /* intervals */
+    std::vector<IntervalGroup *> *igrps = LogDesc->IntervalGroups (desc);
+    if (igrps != 0) {
+	for (unsigned int i = 0;  i < igrps->size();  i++) {
+	    IntervalGroup *grp = igrps->at(i);
+	    std::vector<OpenInterval> &stk = OpenIntervals[IntervalKey_t(vpId, grp)];
+	    if (desc == grp->Start()) {
+		OpenInterval intv = { ts, lp };
+		stk.push_back (intv);
+	    }
+	    else if ((desc == grp->End()) && !stk.empty()) {
+		OpenInterval intv = stk.back();
+		stk.pop_back();
+		PrintSlice (out, grp->Desc(), "interval", vpId, intv.start, ts,
+		    grp->Start(), intv.evt);
+	    }
+	}
+	shown = true;
+    }
+
+  /* states */
+    std::vector<StateGroup *> *sgrps = LogDesc->StateGroups (desc);
+    if (sgrps != 0) {
+	for (unsigned int i = 0;  i < sgrps->size();  i++) {
+	    StateGroup *grp = sgrps->at(i);
+	    int g = std::find(StateGrps.begin(), StateGrps.end(), grp) - StateGrps.begin();
+	    int k = g * Hdr->nVProcs + vpId;
+	    int next = grp->NextState (CurState[k], desc);
+	    if ((next >= 0) && (next != CurState[k])) {
+		PrintSlice (out, grp->StateName(CurState[k]), "state", StateTrack(g, vpId),
+		    StateStart[k], ts, 0, 0);
+		CurState[k] = next;
+		StateStart[k] = ts;
+	    }
+	}
+    }
+
+  /* dependencies; the events are shown as zero-length slices so that the
+   * flow arrows have something to bind to.
+   */
+    std::vector<DependentGroup *> *dgrps = LogDesc->DependentGroups (desc);
+    if (dgrps != 0) {
+	if (! shown) {
+	    PrintSlice (out, desc->Name(), "event", vpId, ts, ts, desc, lp);
+	    shown = true;
+	}
+	for (unsigned int i = 0;  i < dgrps->size();  i++) {
+	    DependentGroup *grp = dgrps->at(i);
+	    if (desc == grp->Src())
+		PrintFlow (out, grp, "s", vpId, ts, GetIdArg(desc, lp, NEW_ID));
+	    else if (desc == grp->Dst())
+		PrintFlow (out, grp, "f", vpId, ts, GetIdArg(desc, lp, EVENT_ID));
+	}
+    }
+
+  /* everything else is an instant event */
+    if (! shown) {
+	StartEvent (out);
+	fprintf (out, "{\"name\":");
+	PrintString (out, desc->Name());
+	fprintf (out, ",\"cat\":\"event\",\"ph\":\"i\",\"s\":\"t\",\"pid\":%d,\"tid\":%d",
+	    TRACE_PID, vpId);
+	PrintTS (out, "ts", ts);
+	PrintArgs (out, desc, lp);
+	fputc ('}', out);
+    }
+
+}
+
+/* close the open intervals and states at the end of the run */
+static void FinishTrace (FILE *out, uint64_t endTime)
+{
+    std::map<IntervalKey_t, std::vector<OpenInterval> >::iterator it;
+    for (it = OpenIntervals.begin();  it != OpenIntervals.end();  it++) {
+	IntervalGroup *grp = it->first.second;
+	std::vector<OpenInterval> &stk = it->second;
+	while (! stk.empty()) {
+	    PrintSlice (out, grp->Desc(), "interval", it->first.first, stk.back().start, endTime,
+		grp->Start(), stk.back().evt);
+	    stk.pop_back();
+	}
+    }
+
+    for (unsigned int g = 0;  g < StateGrps.size();  g++) {
+	for (int vp = 0;  vp < Hdr->nVProcs;  vp++) {
+	    int k = g * Hdr->nVProcs + vp;
+	    PrintSlice (out, StateGrps[g]->StateName(CurState[k]), "state", StateTrack(g, vp),
+		StateStart[k], endTime, 0, 0);
+	}
+    }
+
+}
+
+/* collect the state groups */
+static void FindStateGroups ()
+{
+    class Visitor : public LogDescVisitor {
+      public:
+	void VisitGroup (EventGroup *) { }
+	void VisitStateGroup (StateGroup *grp) { StateGrps.push_back (grp); }
+	void VisitIntervalGroup (IntervalGroup *) { }
+	void VisitDependentGroup (DependentGroup *) { }
+    };
+
+    Visitor v;
+    LogDesc->PreOrderWalk (&v);
+
+}
+
+/***** Loading the log file *****/
+
+/* convert a timestamp to nanoseconds */
+static inline uint64_t GetTimestamp (LogTS_t *ts)
+{
+    if (Hdr->tsKind == LOGTS_MACH_ABSOLUTE)
+	return ts->ts_mach;
+    else if (Hdr->tsKind == LOGTS_TIMESPEC)
+	return ts->ts_val.sec * 1000000000 + ts->ts_val.frac;
+    else /* Hdr->tsKind == LOGTS_TIMEVAL */
+	return ts->ts_val.sec * 1000000000 + ts->ts_val.frac * 1000;
+}
+
+/* compare buffers by sequence number */
+static bool EarlierBuffer (LogBuffer_t *b1, LogBuffer_t *b2)
+{
+    return (b1->seqNum < b2->seqNum);
+}
+
+/* OpenLogFile:
+ *
+ * Map the log file, check its header, and return a cursor for each vproc.
+ */
+static std::vector<VProcCursor *> *OpenLogFile (const char *file, char **basep, off_t *fileSizep)
+{
+  /* get the file size */
+    off_t fileSize;
+    {
+	struct stat st;
+	if (stat(file, &st) < 0) {
+	    perror ("stat");
+	    exit (1);
+	}
+	fileSize = st.st_size;
+    }
+    if (fileSize < LOGBLOCK_SZB) {
+	fprintf(stderr, "no header in file\n");
+	exit (1);
+    }
+
+  /* map the file */
+    int fd = open(file, O_RDONLY);
+    if (fd < 0) {
+	perror ("open");
+	exit (1);
+    }
+    char *base = (char *)mmap(0, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED) {
+	perror ("mmap");
+	exit (1);
+    }
+    close (fd);
+
+  /* read the header */
+    Hdr = new LogFileHeader_t;
+    memcpy (Hdr, base, sizeof(LogFileHeader_t));
+
+  /* check the header */
+    if (Hdr->magic != LOG_MAGIC) {
+	fprintf(stderr, "bogus magic number\n");
+	exit (1);
+    }
+    if (Hdr->hdrSzB != sizeof(LogFileHeader_t)) {
+	fprintf(stderr, "bogus header size %d (expected %d)\n",
+	    Hdr->hdrSzB, (int)sizeof(LogFileHeader_t));
+	exit (1);
+    }
+    if (Hdr->majorVersion != LOG_VERSION_MAJOR) {
+	fprintf(stderr, "wrong version = %d.%d.%d; expected %d.x.y\n",
+	    Hdr->majorVersion, Hdr->minorVersion, Hdr->patchVersion, LOG_VERSION_MAJOR);
+	exit (1);
+    }
+    if (Hdr->bufSzB != LogBufSzB) {
+	fprintf (stderr, "using different block size %d\n", Hdr->bufSzB);
+      // recompute the sizes
+	LogBufSzB = Hdr->bufSzB;
+	NEventsPerBuf = (LogBufSzB / sizeof(LogEvent_t)) - 1;
+    }
+
+  /* the block index at the end of the file (if any) does not hold events */
+    int numBufs = (LogDataSize (file, fileSize) / LogBufSzB) - 1;
+    if (numBufs <= 0) {
+	fprintf(stderr, "no buffers in file\n");
+	exit (1);
+    }
+
+  /* distribute the buffers to the vprocs */
+    std::vector<VProcCursor *> *cursors = new std::vector<VProcCursor *>(Hdr->nVProcs);
+    for (int vp = 0;  vp < Hdr->nVProcs;  vp++) {
+	VProcCursor *c = new VProcCursor;
+	c->vpId = vp;
+	c->buf = 0;
+	c->next = 0;
+	cursors->at(vp) = c;
+    }
+    for (int i = 0;  i < numBufs;  i++) {
+	LogBuffer_t *log = (LogBuffer_t *)(base + (size_t)(i+1) * LogBufSzB);
+      // check for valid vproc ID
+	if ((log->vpId < 0) || (Hdr->nVProcs <= log->vpId)) {
+	    fprintf (stderr, "Invalid vproc ID %d\n", log->vpId);
+	    exit (1);
+	}
+	if (log->next > NEventsPerBuf)
+	    log->next = NEventsPerBuf;
+	if (log->next > 0)
+	    cursors->at(log->vpId)->bufs.push_back (log);
+    }
+    for (int vp = 0;  vp < Hdr->nVProcs;  vp++) {
+	VProcCursor *c = cursors->at(vp);
+	std::stable_sort (c->bufs.begin(), c->bufs.end(), EarlierBuffer);
+	if (c->Peek() != 0)
+	    c->timestamp = GetTimestamp (&(c->Peek()->timestamp));
+    }
+
+    *basep = base;
+    *fileSizep = fileSize;
+    return cursors;
+
+}
+
+static void Usage (int sts)
+{
+    fprintf (stderr, "usage: log-chrome-trace [-o outfile] [-log logfile]\n");
+    exit (sts);
+}
@@ -0,0 +1,38 @@
+/* log-index.cxx
+ *
+ * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
+ * All rights reserved.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "log-file.h"
+#include "log-index.hxx"
+
+off_t LogDataSize (const char *file, off_t fileSize)
+{
+    LogIndexFooter_t footer;
+
+    if (fileSize < (off_t)(LOGBLOCK_SZB + sizeof(footer)))
+	return fileSize;
+
+    int fd = open(file, O_RDONLY);
+    if (fd < 0) {
+	perror ("open");
+	return fileSize;
+    }
+    ssize_t nb = pread (fd, &footer, sizeof(footer), fileSize - sizeof(footer));
+    close (fd);
+
+  /* the index entries must fill the space between the data and the footer */
+    off_t indexEnd = fileSize - sizeof(footer);
+    if ((nb != (ssize_t)sizeof(footer))
+    || (footer.magic != LOG_INDEX_MAGIC)
+    || (footer.indexOffset > (uint64_t)indexEnd)
+    || (footer.indexOffset + (uint64_t)footer.nEntries * sizeof(LogIndexEntry_t) != (uint64_t)indexEnd))
+	return fileSize;
+
+    return footer.indexOffset;
+
+}
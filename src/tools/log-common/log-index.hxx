@@ -0,0 +1,27 @@
+/*! \file log-index.hxx
+ *
+ * \author John Reppy
+ *
+ * Support for reading log files that end with a block index (see log-file.h).
+ */
+
+/*
+ * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
+ * All rights reserved.
+ */
+
+#ifndef _LOG_INDEX_HXX_
+#define _LOG_INDEX_HXX_
+
+#include <sys/types.h>
+
+/*! \brief return the number of bytes at the start of a log file that hold the
+ *  header and the event buffers.
+ *  \param file the name of the log file
+ *  \param fileSize the size of the file in bytes
+ *  \return the offset of the block index if the file has a valid index, and
+ *  fileSize otherwise.
+ */
+extern off_t LogDataSize (const char *file, off_t fileSize);
+
+#endif /* !_LOG_INDEX_HXX_ */
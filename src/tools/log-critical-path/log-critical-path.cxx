@@ -0,0 +1,656 @@
+/* log-critical-path.cxx
+ *
+ * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
+ * All rights reserved.
+ *
+ * Explains why a work-stealing run failed to scale.  The program reconstructs the
+ * dependence DAG of the run from the thread-spawn and work-stealing events and reports
+ *   - the total work (time spent busy executing tasks, excluding GC),
+ *   - the span (the length of the longest path through the DAG) and the available
+ *     parallelism (work / span),
+ *   - the vproc time that was lost to GC, to stealing, to sleeping, and to idling, and
+ *   - a parallelism profile (i.e., how many vprocs were doing what over time) in CSV
+ *     format.
+ *
+ * The nodes of the DAG are strands: maximal intervals in which a vproc is busy
+ * executing work-stealing tasks (WSExecute up to the next WSPreempted, WSThiefSend,
+ * WSSleep, or WSTerminate).  A strand depends on
+ *   - the preceding strand of the same vproc, unless it starts with a stolen task;
+ *   - the victim's strand at the time the thief ran on the victim (WSThiefBegin), if it
+ *     starts with a stolen task (WSThiefSuccessful);
+ *   - the spawning strand at the time of the spawn, for ThdSpawn/ThdSpawnOn events that
+ *     are matched by a ThdStart event in the strand.
+ * An edge from the middle of a strand only carries the work done by that strand up to
+ * the point of the edge.  Since the logs do not record joins, the span is a lower bound.
+ */
+
+//#include "manticore-config.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include "log-file.h"
+#include "event-desc.hxx"
+#include "log-desc.hxx"
+#include "log-index.hxx"
+#include "default-log-paths.h"
+
+#define logDescFile	DEFAULT_LOG_EVENTS_PATH
+#define logViewFile	DEFAULT_LOG_VIEW_PATH
+
+/* the actual size of a block in the log buffer */
+static size_t	LogBufSzB = LOGBLOCK_SZB;
+static int	NEventsPerBuf = LOGBUF_SZ;
+
+/* internal representation of event occurrences */
+struct Event {
+    uint64_t		timestamp;	// time stamp
+    int32_t		vpId;		// vproc ID
+    EventDesc		*desc;		// description of the event
+    uint64_t		id;		// the event's thread/thief ID argument (0 if none)
+};
+
+/* what a vproc is doing during a segment of the run */
+enum Activity {
+    IDLE,		//!< inactive worker
+    BUSY,		//!< executing tasks
+    STEAL,		//!< trying to steal a task
+    SLEEP,		//!< sleeping
+    GC,			//!< garbage collecting (overrides the other activities)
+    NUM_ACTIVITIES
+};
+
+static const char *ActivityName[NUM_ACTIVITIES] = {
+	"idle", "busy", "steal", "sleep", "gc"
+    };
+
+/* a strand is a maximal interval in which a vproc is busy executing tasks */
+struct Strand {
+    int32_t		vpId;
+    uint64_t		start;		// timestamp of the start of the strand
+    uint64_t		end;		// timestamp of the end of the strand
+    uint64_t		work;		// busy time of the strand, excluding GC
+    int			prev;		// the preceding strand of the same vproc (-1 if none)
+    bool		stolen;		// true, if the strand starts with a stolen task
+    std::vector<uint64_t> deps;		// thread/thief IDs that the strand depends on
+  // results of the critical-path analysis
+    uint64_t		dist;		// length of the longest path to the start of the strand
+    int			critPred;	// the strand that determines dist (-1 if none)
+};
+
+/* a point in a strand that other strands can depend on (a spawn or a steal) */
+struct Anchor {
+    int			strand;		// the strand that the point is in, or the last strand
+					// before the point (-1 if there is none)
+    uint64_t		work;		// the strand's work up to the point
+};
+
+LogFileHeader_t		*Hdr;		/* the file's header */
+Event			*Events;	/* an array of all of the events */
+int			NumEvents;	/* number of events */
+
+static std::vector<Strand>	Strands;
+static std::map<uint64_t, Anchor> Anchors;	/* anchors indexed by thread/thief ID */
+
+/* the window of the run that is analysed */
+static uint64_t		StartTime;
+static uint64_t		EndTime;
+
+/* the parallelism profile: vproc time per activity for each time bin */
+static int		NumBins = 100;
+static uint64_t		BinSz;
+static uint64_t		(*Profile)[NUM_ACTIVITIES];
+static uint64_t		TotalTime[NUM_ACTIVITIES];
+
+static void LoadLogFile (LogFileDesc *logFileDesc, const char *file);
+static void BuildStrands ();
+static void AddSegment (int vpId, uint64_t t0, uint64_t t1, Activity act);
+static void ComputeCriticalPath (int *lastStrand);
+static void PrintProfile (FILE *out);
+static void PrintTimestamp (FILE *out, uint64_t timestamp);
+static void Usage (int sts);
+static inline uint64_t max (uint64_t x, uint64_t y) { return x < y ? y : x; }
+
+int main (int argc, const char **argv)
+{
+    const char *logFile = DFLT_LOG_FILE;
+    const char *csvFile = 0;
+    FILE *out = stdout;
+
+  // process args
+    for (int i = 1;  i < argc; ) {
+	if (strcmp(argv[i], "-h") == 0) {
+	    Usage (0);
+	}
+	else if (strcmp(argv[i], "-o") == 0) {
+	    if (++i < argc) {
+		out = fopen(argv[i], "w"); i++;
+		if (out == NULL) {
+		    perror("fopen");
+		    exit(1);
+		}
+	    }
+	    else {
+		fprintf(stderr, "missing filename for \"-o\" option\n");
+		Usage (1);
+	    }
+	}
+	else if (strcmp(argv[i], "-log") == 0) {
+	    if (++i < argc) {
+		logFile = argv[i]; i++;
+	    }
+	    else {
+		fprintf(stderr, "missing filename for \"-log\" option\n");
+		Usage (1);
+	    }
+	}
+	else if (strcmp(argv[i], "-csv") == 0) {
+	    if (++i < argc) {
+		csvFile = argv[i]; i++;
+	    }
+	    else {
+		fprintf(stderr, "missing filename for \"-csv\" option\n");
+		Usage (1);
+	    }
+	}
+	else if (strcmp(argv[i], "-bins") == 0) {
+	    if (++i < argc) {
+		NumBins = atoi(argv[i]); i++;
+		if (NumBins < 1) {
+		    fprintf(stderr, "bogus number of bins for \"-bins\" option\n");
+		    Usage (1);
+		}
+	    }
+	    else {
+		fprintf(stderr, "missing number for \"-bins\" option\n");
+		Usage (1);
+	    }
+	}
+	else {
+	    fprintf(stderr, "invalid argument \"%s\"\n", argv[i]);
+	    Usage(1);
+	}
+    }
+
+    LogFileDesc *logFileDesc = LoadLogDesc (logDescFile, logViewFile);
+    if (logFileDesc == 0) {
+	fprintf(stderr, "unable to load \"%s\"\n", logDescFile);
+	exit (1);
+    }
+
+    LoadLogFile (logFileDesc, logFile);
+
+  /* the analysis window runs from the first WSInit event to the last event */
+    StartTime = 0;
+    for (int i = 0;  i < NumEvents;  i++) {
+	if (Events[i].desc->Id() == WSInitEvt) {
+	    StartTime = Events[i].timestamp;
+	    break;
+	}
+    }
+    EndTime = Events[NumEvents-1].timestamp;
+    BinSz = (EndTime - StartTime + NumBins - 1) / NumBins;
+    if (BinSz == 0) BinSz = 1;
+    Profile = new uint64_t[NumBins][NUM_ACTIVITIES];
+    for (int b = 0;  b < NumBins;  b++)
+	for (int a = 0;  a < NUM_ACTIVITIES;  a++)
+	    Profile[b][a] = 0;
+    for (int a = 0;  a < NUM_ACTIVITIES;  a++)
+	TotalTime[a] = 0;
+
+    BuildStrands ();
+
+    int lastStrand;
+    ComputeCriticalPath (&lastStrand);
+
+  /* summarize the critical path */
+    uint64_t work = 0;
+    for (unsigned int i = 0;  i < Strands.size();  i++)
+	work += Strands[i].work;
+    uint64_t span = 0;
+    int critLen = 0, critSteals = 0, critVProcSwitches = 0;
+    if (lastStrand >= 0) {
+	span = Strands[lastStrand].dist + Strands[lastStrand].work;
+	for (int s = lastStrand;  s >= 0;  s = Strands[s].critPred) {
+	    critLen++;
+	    int p = Strands[s].critPred;
+	    if (p >= 0) {
+		if (Strands[s].stolen) critSteals++;
+		if (Strands[p].vpId != Strands[s].vpId) critVProcSwitches++;
+	    }
+	}
+    }
+
+    uint64_t elapsed = EndTime - StartTime;
+    uint64_t vprocTime = elapsed * Hdr->nVProcs;
+    uint64_t lost = vprocTime - TotalTime[BUSY];
+
+    fprintf (out, "Log taken on %s\n", Hdr->date);
+    fprintf (out, "%d/%d processors; %d events; clock = %s\n",
+	Hdr->nVProcs, Hdr->nCPUs, NumEvents, Hdr->clockName);
+    fprintf (out, "elapsed:      "); PrintTimestamp (out, elapsed); fprintf (out, " sec.\n");
+    fprintf (out, "work:         "); PrintTimestamp (out, work);
+	fprintf (out, " sec. in %d strands\n", (int)Strands.size());
+    fprintf (out, "span:         "); PrintTimestamp (out, span);
+	fprintf (out, " sec. over %d strands (%d steals, %d vproc switches)\n",
+	    critLen, critSteals, critVProcSwitches);
+    if (span > 0)
+	fprintf (out, "parallelism:  %.2f (achieved %.2f of %d vprocs)\n",
+	    (double)work / (double)span,
+	    (elapsed > 0) ? (double)TotalTime[BUSY] / (double)elapsed : 0.0,
+	    Hdr->nVProcs);
+    fprintf (out, "lost vproc time: "); PrintTimestamp (out, lost);
+	fprintf (out, " sec. (%.1f%%)\n", (vprocTime > 0) ? 100.0 * (double)lost / (double)vprocTime : 0.0);
+    for (int a = 0;  a < NUM_ACTIVITIES;  a++) {
+	if (a == BUSY) continue;
+	fprintf (out, "  %-6s        ", ActivityName[a]);
+	PrintTimestamp (out, TotalTime[a]);
+	fprintf (out, " sec. (%.1f%%)\n", (lost > 0) ? 100.0 * (double)TotalTime[a] / (double)lost : 0.0);
+    }
+
+    if (csvFile != 0) {
+	FILE *csv = fopen(csvFile, "w");
+	if (csv == NULL) {
+	    perror("fopen");
+	    exit(1);
+	}
+	PrintProfile (csv);
+	fclose (csv);
+    }
+
+}
+
+/* BuildStrands:
+ *
+ * Walk the events in order, tracking the activity of each vproc, to build the
+ * strands, the anchors of the spawn/steal dependencies, and the activity profile.
+ */
+static void BuildStrands ()
+{
+    Activity	state[Hdr->nVProcs];	// the work-stealing state of each vproc
+    int		gcDepth[Hdr->nVProcs];	// nesting depth of GC intervals
+    uint64_t	lastTS[Hdr->nVProcs];	// the time of the last change of activity
+    int		curStrand[Hdr->nVProcs];	// the current strand (-1 if not busy)
+    int		lastStrand[Hdr->nVProcs];	// the most recent strand
+    bool	stolen[Hdr->nVProcs];	// true, if the next strand starts with a stolen task
+    std::vector<uint64_t> pending[Hdr->nVProcs];	// dependencies of the next strand
+
+    for (int i = 0;  i < Hdr->nVProcs;  i++) {
+	state[i] = IDLE;
+	gcDepth[i] = 0;
+	lastTS[i] = StartTime;
+	curStrand[i] = -1;
+	lastStrand[i] = -1;
+	stolen[i] = false;
+    }
+
+    for (int i = 0;  i < NumEvents;  i++) {
+	Event *evt = &(Events[i]);
+	if (evt->timestamp < StartTime)
+	    continue;
+
+	int vp = evt->vpId;
+	Activity nextState = state[vp];
+	int nextDepth = gcDepth[vp];
+	switch (evt->desc->Id()) {
+	  case WSExecuteEvt:
+	    nextState = BUSY;
+	    break;
+	  case WSPreemptedEvt:
+	  case WSTerminateEvt:
+	    nextState = IDLE;
+	    break;
+	  case WSThiefSendEvt:
+	    nextState = STEAL;
+	    break;
+	  case WSSleepEvt:
+	    nextState = SLEEP;
+	    break;
+	  case WSThiefBeginEvt:
+	  case ThdSpawnEvt:
+	  case ThdSpawnOnEvt: {
+	      Anchor anchor;
+	      if (curStrand[vp] >= 0) {
+		  Strand *s = &(Strands[curStrand[vp]]);
+		  anchor.strand = curStrand[vp];
+		  anchor.work = s->work + ((gcDepth[vp] == 0) ? evt->timestamp - lastTS[vp] : 0);
+	      }
+	      else {
+		  anchor.strand = lastStrand[vp];
+		  anchor.work = (lastStrand[vp] >= 0) ? Strands[lastStrand[vp]].work : 0;
+	      }
+	      Anchors[evt->id] = anchor;
+	    } break;
+	  case WSThiefSuccessfulEvt:
+	    stolen[vp] = true;
+	    pending[vp].push_back (evt->id);
+	    break;
+	  case ThdStartEvt:
+	    if (curStrand[vp] >= 0)
+		Strands[curStrand[vp]].deps.push_back (evt->id);
+	    else
+		pending[vp].push_back (evt->id);
+	    break;
+	  case MinorGCStartEvt:
+	  case MajorGCStartEvt:
+	  case GlobalGCVPStartEvt:
+	  case PromoteStartEvt:
+	    nextDepth++;
+	    break;
+	  case MinorGCEndEvt:
+	  case MajorGCEndEvt:
+	  case GlobalGCVPDoneEvt:
+	  case PromoteEndEvt:
+	    if (nextDepth > 0) nextDepth--;
+	    break;
+	}
+
+	if ((nextState == state[vp]) && (nextDepth == gcDepth[vp]))
+	    continue;
+
+      /* close the current segment */
+	Activity act = (gcDepth[vp] > 0) ? GC : state[vp];
+	AddSegment (vp, lastTS[vp], evt->timestamp, act);
+	if ((act == BUSY) && (curStrand[vp] >= 0))
+	    Strands[curStrand[vp]].work += evt->timestamp - lastTS[vp];
+	lastTS[vp] = evt->timestamp;
+
+      /* start or end strands */
+	if ((state[vp] != BUSY) && (nextState == BUSY)) {
+	    Strand s;
+	    s.vpId = vp;
+	    s.start = evt->timestamp;
+	    s.end = evt->timestamp;
+	    s.work = 0;
+	    s.prev = lastStrand[vp];
+	    s.stolen = stolen[vp];
+	    s.deps.swap (pending[vp]);
+	    s.dist = 0;
+	    s.critPred = -1;
+	    curStrand[vp] = Strands.size();
+	    Strands.push_back (s);
+	    stolen[vp] = false;
+	}
+	else if ((state[vp] == BUSY) && (nextState != BUSY)) {
+	    Strands[curStrand[vp]].end = evt->timestamp;
+	    lastStrand[vp] = curStrand[vp];
+	    curStrand[vp] = -1;
+	}
+	state[vp] = nextState;
+	gcDepth[vp] = nextDepth;
+    }
+
+  /* close out the vprocs at the end of the run */
+    for (int vp = 0;  vp < Hdr->nVProcs;  vp++) {
+	Activity act = (gcDepth[vp] > 0) ? GC : state[vp];
+	AddSegment (vp, lastTS[vp], EndTime, act);
+	if (curStrand[vp] >= 0) {
+	    Strand *s = &(Strands[curStrand[vp]]);
+	    if (act == BUSY)
+		s->work += EndTime - lastTS[vp];
+	    s->end = EndTime;
+	}
+    }
+
+}
+
+/* add a segment of activity to the profile */
+static void AddSegment (int vpId, uint64_t t0, uint64_t t1, Activity act)
+{
+    if (t1 <= t0)
+	return;
+
+    TotalTime[act] += t1 - t0;
+
+    int b = (t0 - StartTime) / BinSz;
+    while ((t0 < t1) && (b < NumBins)) {
+	uint64_t binEnd = StartTime + (uint64_t)(b+1) * BinSz;
+	uint64_t t = (t1 < binEnd) ? t1 : binEnd;
+	Profile[b][act] += t - t0;
+	t0 = t;
+	b++;
+    }
+
+}
+
+/* compare strands by their start time */
+static bool StartsBefore (int s1, int s2)
+{
+    if (Strands[s1].start != Strands[s2].start)
+	return Strands[s1].start < Strands[s2].start;
+    else
+	return Strands[s1].vpId < Strands[s2].vpId;
+}
+
+/* ComputeCriticalPath:
+ *
+ * Compute the longest path to the start of each strand.  Edges go forward in time,
+ * so the strands are processed in the order of their start times; edges that appear
+ * to go backward in time (because of clock skew between the vprocs) are ignored.
+ * Sets lastStrand to the strand at the end of the critical path.
+ */
+static void ComputeCriticalPath (int *lastStrand)
+{
+    std::vector<int> order(Strands.size());
+    std::vector<bool> done(Strands.size(), false);
+    for (unsigned int i = 0;  i < Strands.size();  i++)
+	order[i] = i;
+    std::sort (order.begin(), order.end(), StartsBefore);
+
+    *lastStrand = -1;
+    uint64_t span = 0;
+    for (unsigned int i = 0;  i < order.size();  i++) {
+	Strand *s = &(Strands[order[i]]);
+      /* program-order edge */
+	if ((! s->stolen) && (s->prev >= 0) && done[s->prev]) {
+	    Strand *p = &(Strands[s->prev]);
+	    s->dist = p->dist + p->work;
+	    s->critPred = s->prev;
+	}
+      /* spawn and steal edges */
+	for (unsigned int j = 0;  j < s->deps.size();  j++) {
+	    std::map<uint64_t, Anchor>::iterator it = Anchors.find(s->deps[j]);
+	    if ((it == Anchors.end()) || (it->second.strand < 0) || !done[it->second.strand])
+		continue;
+	    Strand *p = &(Strands[it->second.strand]);
+	    uint64_t d = p->dist + it->second.work;
+	    if (d > s->dist) {
+		s->dist = d;
+		s->critPred = it->second.strand;
+	    }
+	}
+	done[order[i]] = true;
+	if ((*lastStrand < 0) || (s->dist + s->work > span)) {
+	    span = s->dist + s->work;
+	    *lastStrand = order[i];
+	}
+    }
+
+}
+
+/* PrintProfile:
+ *
+ * Print the parallelism profile in CSV format.  Each row is a time bin; the
+ * activity columns give the average number of vprocs engaged in the activity
+ * during the bin.
+ */
+static void PrintProfile (FILE *out)
+{
+    fprintf (out, "start,end");
+    for (int a = 0;  a < NUM_ACTIVITIES;  a++)
+	fprintf (out, ",%s", ActivityName[a]);
+    fprintf (out, "\n");
+
+    for (int b = 0;  b < NumBins;  b++) {
+	uint64_t t0 = (uint64_t)b * BinSz;
+	uint64_t t1 = t0 + BinSz;
+	if (StartTime + t0 >= EndTime)
+	    break;
+	if (StartTime + t1 > EndTime)
+	    t1 = EndTime - StartTime;
+	fprintf (out, "%" PRIu64 ",%" PRIu64, StartTime + t0, StartTime + t1);
+	for (int a = 0;  a < NUM_ACTIVITIES;  a++)
+	    fprintf (out, ",%.3f", (double)Profile[b][a] / (double)(t1 - t0));
+	fprintf (out, "\n");
+    }
+
+}
+
+/* compare function for events */
+int CompareEvent (const void *ev1, const void *ev2)
+{
+    int64_t t = (int64_t)((Event *)ev1)->timestamp - (int64_t)((Event *)ev2)->timestamp;
+    if (t == 0) return (((Event *)ev1)->vpId - ((Event *)ev2)->vpId);
+    else if (t < 0) return -1;
+    else return 1;
+
+}
+
+/* convert a timestamp to nanoseconds */
+static inline uint64_t GetTimestamp (LogTS_t *ts)
+{
+    if (Hdr->tsKind == LOGTS_MACH_ABSOLUTE)
+	return ts->ts_mach;
+    else if (Hdr->tsKind == LOGTS_TIMESPEC)
+	return ts->ts_val.sec * 1000000000 + ts->ts_val.frac;
+    else /* Hdr->tsKind == LOGTS_TIMEVAL */
+	return ts->ts_val.sec * 1000000000 + ts->ts_val.frac * 1000;
+}
+
+static void LoadLogFile (LogFileDesc *logFileDesc, const char *file)
+{
+    char	*buf = new char[LOGBLOCK_SZB];
+
+  /* get the file size */
+    off_t fileSize;
+    {
+	struct stat st;
+	if (stat(file, &st) < 0) {
+	    perror ("stat");
+	    exit (1);
+	}
+	fileSize = st.st_size;
+    }
+
+  /* open the file */
+    FILE *f = fopen(file, "rb");
+    if (f == NULL) {
+	perror ("fopen");
+	exit (1);
+    }
+
+  /* read the header */
+    int ignored = fread (buf, LOGBLOCK_SZB, 1, f);
+    Hdr = new LogFileHeader_t;
+    memcpy (Hdr, buf, sizeof(LogFileHeader_t));
+
+  /* check the header */
+    if (Hdr->magic != LOG_MAGIC) {
+	fprintf(stderr, "bogus magic number\n");
+	exit (1);
+    }
+    if (Hdr->hdrSzB != sizeof(LogFileHeader_t)) {
+	fprintf(stderr, "bogus header size %d (expected %d)\n",
+	    Hdr->hdrSzB, (int)sizeof(LogFileHeader_t));
+	exit (1);
+    }
+    if (Hdr->majorVersion != LOG_VERSION_MAJOR) {
+	fprintf(stderr, "wrong version = %d.%d.%d; expected %d.x.y\n",
+	    Hdr->majorVersion, Hdr->minorVersion, Hdr->patchVersion, LOG_VERSION_MAJOR);
+	exit (1);
+    }
+    if (Hdr->bufSzB != LogBufSzB) {
+	fprintf (stderr, "using different block size %d\n", Hdr->bufSzB);
+      // recompute the sizes
+	LogBufSzB = Hdr->bufSzB;
+	NEventsPerBuf = (LogBufSzB / sizeof(LogEvent_t)) - 1;
+      // reallocate the input buffer
+	delete[] buf;
+	buf = new char[LogBufSzB];
+      // reset the input file pointer
+	if (fseek(f, LogBufSzB, SEEK_SET) == -1) {
+	    perror ("fseek");
+	    exit (1);
+	}
+    }
+
+  /* the block index at the end of the file (if any) does not hold events */
+    int numBufs = (LogDataSize (file, fileSize) / LogBufSzB) - 1;
+    if (numBufs <= 0) {
+	fprintf(stderr, "no buffers in file\n");
+	exit (1);
+    }
+
+    int MaxNumEvents = NEventsPerBuf*numBufs;
+    Events = new Event[MaxNumEvents];
+    NumEvents = 0;
+
+  /* read in the events */
+    for (int i = 0;  i < numBufs;  i++) {
+	ignored = fread (buf, LogBufSzB, 1, f);
+	LogBuffer_t *log = (LogBuffer_t *)buf;
+      // check for valid vproc ID
+	if ((log->vpId < 0) || (Hdr->nVProcs <= log->vpId)) {
+	    fprintf (stderr, "Invalid vproc ID %d\n", log->vpId);
+	    exit (1);
+	}
+	if (log->next > NEventsPerBuf)
+	    log->next = NEventsPerBuf;
+	for (int j = 0;  j < log->next;  j++) {
+	    assert (NumEvents < MaxNumEvents);
+	    LogEvent_t *lp = &(log->log[j]);
+	    Event *ep = &(Events[NumEvents++]);
+	  /* extract event and data fields */
+	    ep->timestamp = GetTimestamp(&(lp->timestamp));
+	    ep->vpId = log->vpId;
+	    ep->desc = logFileDesc->FindEventById (lp->event);
+	    ep->id = 0;
+	    if (ep->desc->NArgs() > 0) {
+		ArgType ty = ep->desc->GetArgType(0);
+		if ((ty == NEW_ID) || (ty == EVENT_ID))
+		    ep->id = ep->desc->GetArg(lp, 0).id;
+	    }
+	}
+    }
+
+    if (NumEvents == 0) {
+	fprintf(stderr, "no events in file\n");
+	exit (1);
+    }
+
+  /* sort the events by timestamp */
+    qsort (Events, NumEvents, sizeof(Event), CompareEvent);
+
+  /* Adjust the timestamps to be relative to the start of the run */
+    uint64_t startTime = GetTimestamp (&(Hdr->startTime));
+    if (Events[0].timestamp < startTime) {
+	fprintf (stderr, "** Warning: first event occurs %" PRIu64 " ns. before start\n",
+	    startTime - Events[0].timestamp);
+	startTime = Events[0].timestamp;
+    }
+    for (int i = 0;  i < NumEvents;  i++) {
+	Events[i].timestamp -= startTime;
+    }
+
+    fclose (f);
+    delete[] buf;
+
+}
+
+static void PrintTimestamp (FILE *out, uint64_t timestamp)
+{
+    fprintf (out, "%3d.%09d",
+	     (int)(timestamp / 1000000000),
+	     (int)(timestamp % 1000000000));
+}
+
+static void Usage (int sts)
+{
+    fprintf (stderr, "usage: log-critical-path [-o outfile] [-csv csvfile] [-bins n] [-log logfile]\n");
+    exit (sts);
+}
@@ -20,6 +20,7 @@
 #include "log-file.h"
 #include "event-desc.hxx"
 #include "log-desc.hxx"
+#include "log-index.hxx"
 #include "default-log-paths.h"
 
 #define logDescFile	DEFAULT_LOG_EVENTS_PATH
@@ -179,7 +180,8 @@ static void LoadLogFile (LogFileDesc *logFileDesc, const char *file)
 	}
     }
 
-    int numBufs = (fileSize / LogBufSzB) - 1;
+  /* the block index at the end of the file (if any) does not hold events */
+    int numBufs = (LogDataSize (file, fileSize) / LogBufSzB) - 1;
     if (numBufs <= 0) {
 	fprintf(stderr, "no buffers in file\n");
 	exit (1);
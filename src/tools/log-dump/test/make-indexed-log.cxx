@@ -0,0 +1,85 @@
+/* make-indexed-log.cxx
+ *
+ * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
+ * All rights reserved.
+ *
+ * Write a log file that ends with a block index, for testing the log readers.
+ * The file has NUM_BUFS buffers for NUM_VPROCS vprocs with one event each, and
+ * enough buffers that the index is larger than a log block.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "log-file.h"
+
+#define NUM_VPROCS	2
+#define NUM_BUFS	300
+
+int main (int argc, const char **argv)
+{
+    if (argc != 2) {
+	fprintf (stderr, "usage: make-indexed-log file\n");
+	exit (1);
+    }
+
+    FILE *f = fopen(argv[1], "wb");
+    if (f == NULL) {
+	perror ("fopen");
+	exit (1);
+    }
+
+    char *block = new char[LOGBLOCK_SZB];
+
+  /* the header */
+    memset (block, 0, LOGBLOCK_SZB);
+    LogFileHeader_t *hdr = (LogFileHeader_t *)block;
+    hdr->magic = LOG_MAGIC;
+    hdr->majorVersion = LOG_VERSION_MAJOR;
+    hdr->minorVersion = LOG_VERSION_MINOR;
+    hdr->patchVersion = LOG_VERSION_PATCH;
+    hdr->hdrSzB = sizeof(LogFileHeader_t);
+    hdr->bufSzB = LOGBLOCK_SZB;
+    strncpy (hdr->date, "test", sizeof(hdr->date));
+    hdr->tsKind = LOGTS_TIMESPEC;
+    strncpy (hdr->clockName, "test", sizeof(hdr->clockName));
+    hdr->resolution = 1;
+    hdr->nVProcs = NUM_VPROCS;
+    hdr->nCPUs = NUM_VPROCS;
+    fwrite (block, LOGBLOCK_SZB, 1, f);
+
+  /* the buffers, which alternate between the vprocs */
+    LogIndexEntry_t index[NUM_BUFS];
+    for (int i = 0;  i < NUM_BUFS;  i++) {
+	memset (block, 0, LOGBLOCK_SZB);
+	LogBuffer_t *buf = (LogBuffer_t *)block;
+	buf->vpId = i % NUM_VPROCS;
+	buf->next = 1;
+	buf->seqNum = i / NUM_VPROCS;
+	buf->log[0].timestamp.ts_val.sec = 0;
+	buf->log[0].timestamp.ts_val.frac = i;
+	buf->log[0].event = 1;	// the first event in test/log-events.json
+	fwrite (block, LOGBLOCK_SZB, 1, f);
+      /* the index is sorted by vproc and then by time */
+	LogIndexEntry_t *ent = &(index[buf->vpId * (NUM_BUFS / NUM_VPROCS) + buf->seqNum]);
+	ent->offset = (uint64_t)(i + 1) * LOGBLOCK_SZB;
+	ent->firstTS = i;
+	ent->lastTS = i;
+	ent->szB = LOGBLOCK_SZB;
+	ent->vpId = buf->vpId;
+    }
+
+  /* the index and its footer */
+    LogIndexFooter_t footer;
+    footer.indexOffset = (uint64_t)(NUM_BUFS + 1) * LOGBLOCK_SZB;
+    footer.nEntries = NUM_BUFS;
+    footer.nVProcs = NUM_VPROCS;
+    footer.magic = LOG_INDEX_MAGIC;
+    fwrite (index, sizeof(LogIndexEntry_t), NUM_BUFS, f);
+    fwrite (&footer, sizeof(footer), 1, f);
+
+    fclose (f);
+    delete[] block;
+
+    return 0;
+}
@@ -32,7 +32,7 @@ WithArgsAttrs::WithArgsAttrs (EventDesc *d, LogEvent_t *rawEvt)
 
 WithArgsAttrs::~WithArgsAttrs ()
 {
-    delete this->_args;
+    delete[] this->_args;
 }
 
 TaggedArgValue WithArgsAttrs::Arg (int i) const
@@ -140,6 +140,34 @@ Time_t MachAbsoluteCvt (LogTS_t t)
     return t.ts_mach;
 }
 
+/***** struct VProcTrace members *****/
+
+uint32_t VProcTrace::BlockByTimestamp (Time_t t) const
+{
+    uint32_t lo = 0, hi = this->numBlocks;
+    while (lo < hi) {
+	uint32_t mid = lo + (hi - lo) / 2;
+	if (this->blocks[mid].lastTS < t)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    return lo;
+}
+
+void VProcTrace::ClearEvents ()
+{
+    if (this->events != 0) {
+	for (uint64_t i = 1;  i <= this->numEvents;  i++) {
+	    if (! this->events[i].attrs->IsShared())
+		delete this->events[i].attrs;
+	}
+	delete[] this->events;
+	this->events = 0;
+	this->numEvents = 0;
+    }
+}
+
 /***** class LogFile members *****/
 
 LogFile::LogFile (const char *logDescFileName)
@@ -148,6 +176,8 @@ LogFile::LogFile (const char *logDescFileName)
     this->_startTime = 0;
     this->_endTime = 0;
     this->_traces = 0;
+    this->_addr = 0;
+    this->_mapSzB = 0;
 
     if (! this->_filter.Init(logDescFileName)) {
       // error loading log-description file
@@ -159,9 +189,12 @@ LogFile::LogFile (const char *logDescFileName)
 LogFile::~LogFile ()
 {
     if (this->_nVProcs != 0) {
-	delete this->_traces;
+	delete[] this->_traces;
 //	delete this->_timeline;
     }
+    if (this->_addr != 0) {
+	munmap (this->_addr, this->_mapSzB);
+    }
 
 }
 
@@ -183,6 +216,10 @@ bool LogFile::LoadFile (const char *file)
 	}
 	fileSize = st.st_size;
     }
+    if (fileSize < LOGBLOCK_SZB) {
+	fprintf(stderr, "file too small\n");
+	return false;
+    }
 
   /* open the file */
     FILE *f = fopen(file, "rb");
@@ -191,119 +228,230 @@ bool LogFile::LoadFile (const char *file)
 	return false;
     }
 
-  /* read the header */
-    LogFileHeader_t hdr;
-    fread (&hdr, sizeof(LogFileHeader_t), 1, f);
+  /* memory-map the file; pages are only read when the events that they hold are
+   * loaded into a window.
+   */
+    void *addr = mmap (0, fileSize, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+    fclose (f);
+    if (addr == (void *)-1) {
+	perror ("mmap");
+	return false;
+    }
+    this->_addr = addr;
+    this->_mapSzB = fileSize;
 
   /* check the header */
-    if (hdr.magic != LOG_MAGIC) {
+    LogFileHeader_t *hdr = static_cast<LogFileHeader_t *>(addr);
+    if (hdr->magic != LOG_MAGIC) {
 	fprintf(stderr, "bogus magic number\n");
 	return false;
     }
-    if (hdr.hdrSzB != sizeof(LogFileHeader_t)) {
-	fprintf(stderr, "bogus header size %d (expected %d)\n", hdr.hdrSzB, sizeof(LogFileHeader_t));
+    if (hdr->hdrSzB != sizeof(LogFileHeader_t)) {
+	fprintf(stderr, "bogus header size %d (expected %d)\n", hdr->hdrSzB, (int)sizeof(LogFileHeader_t));
 	return false;
     }
-    if (hdr.majorVersion != LOG_VERSION_MAJOR) {
+    if (hdr->majorVersion != LOG_VERSION_MAJOR) {
 	fprintf(stderr, "wrong version = %d.%d.%d; expected %d.x.y\n",
-	    hdr.majorVersion, hdr.minorVersion, hdr.patchVersion, LOG_VERSION_MAJOR);
+	    hdr->majorVersion, hdr->minorVersion, hdr->patchVersion, LOG_VERSION_MAJOR);
 	return false;
     }
 
-    size_t LogBufSzB = LOGBLOCK_SZB;
-    int NEventsPerBuf = LOGBUF_SZ;
-    if (hdr.bufSzB != LogBufSzB) {
-	fprintf (stderr, "using different block size %d\n", hdr.bufSzB);
+    this->_bufSzB = LOGBLOCK_SZB;
+    this->_nEventsPerBuf = LOGBUF_SZ;
+    if (hdr->bufSzB != this->_bufSzB) {
+	fprintf (stderr, "using different block size %d\n", hdr->bufSzB);
       // recompute the sizes
-	LogBufSzB = hdr.bufSzB;
-	NEventsPerBuf = (LogBufSzB / sizeof(LogEvent_t)) - 1;
+	this->_bufSzB = hdr->bufSzB;
+	this->_nEventsPerBuf = (this->_bufSzB / sizeof(LogEvent_t)) - 1;
     }
 
-  // compute the number of buffers in the log
-    int numBufs = (fileSize / LogBufSzB) - 1;
-    if (numBufs <= 0) {
-	fprintf(stderr, "no buffers in file\n");
+  // get the timestamp format and start time
+    if (hdr->tsKind == LOGTS_TIMEVAL) this->_convertTime = TimevalCvt;
+    else if (hdr->tsKind == LOGTS_TIMESPEC) this->_convertTime = TimespecCvt;
+    else this->_convertTime = MachAbsoluteCvt;
+    this->_logStart = this->_convertTime (hdr->startTime);
+
+    this->_nVProcs = hdr->nVProcs;
+    this->_traces = new VProcTrace [hdr->nVProcs];
+    for (int i = 0;  i < hdr->nVProcs;  i++) {
+	this->_traces[i].vprocId = i;
+	this->_traces[i].cpuId = i;	// FIXME
+    }
+
+  /* build the per-vproc block tables from the index at the end of the file or,
+   * for older files, by scanning the buffer headers.
+   */
+    if (! this->LoadIndex (fileSize) && ! this->ScanBlocks (fileSize)) {
 	return false;
     }
 
-  // get the timestamp format and start time
-    TimeCvtFn_t convertTime;
-    if (hdr.tsKind == LOGTS_TIMEVAL) convertTime = TimevalCvt;
-    else if (hdr.tsKind == LOGTS_TIMESPEC) convertTime = TimespecCvt;
-    else convertTime = MachAbsoluteCvt;
-    Time_t startTime = convertTime (hdr.startTime);
-
-  // memory-map the rest of the file
-    size_t szB = numBufs*LogBufSzB;
-    void *addr = mmap (0, szB, PROT_READ, MAP_PRIVATE, fileno(f), LogBufSzB);
-    if (addr == (void *)-1) {
-	perror ("mmap");
+  /* compute the extent of the run */
+    this->_startTime = 0;
+    this->_endTime = 0;
+    for (int i = 0;  i < this->_nVProcs;  i++) {
+	VProcTrace *trace = &(this->_traces[i]);
+	if (trace->numBlocks == 0)
+	    fprintf (stderr, "warning: no events for VProc %d\n", i);
+	else if (this->_endTime < trace->blocks[trace->numBlocks-1].lastTS)
+	    this->_endTime = trace->blocks[trace->numBlocks-1].lastTS;
+    }
+
+    return true;
+}
+
+// convert a raw timestamp to a time relative to the start of the run
+//
+static inline Time_t Normalize (Time_t t, Time_t start)
+{
+    return (t > start) ? t - start : 0;
+}
+
+// initialize the block tables from the index at the end of the log file.  Returns
+// false if the file does not have a valid index.
+//
+bool LogFile::LoadIndex (size_t fileSize)
+{
+    if (fileSize < LOGBLOCK_SZB + sizeof(LogIndexFooter_t))
+	return false;
+
+    char *base = static_cast<char *>(this->_addr);
+    LogIndexFooter_t *footer = reinterpret_cast<LogIndexFooter_t *>(
+	base + fileSize - sizeof(LogIndexFooter_t));
+    if ((footer->magic != LOG_INDEX_MAGIC)
+    || (footer->nVProcs != (uint32_t)this->_nVProcs)
+    || (footer->indexOffset + footer->nEntries * sizeof(LogIndexEntry_t)
+	    != fileSize - sizeof(LogIndexFooter_t)))
 	return false;
+
+    LogIndexEntry_t *index = reinterpret_cast<LogIndexEntry_t *>(base + footer->indexOffset);
+
+  /* check the entries and count the blocks per vproc */
+    for (uint32_t i = 0;  i < footer->nEntries;  i++) {
+	if ((index[i].vpId >= (uint32_t)this->_nVProcs)
+	|| (index[i].offset + this->_bufSzB > footer->indexOffset)) {
+	    fprintf (stderr, "bogus log index; scanning file\n");
+	    for (int j = 0;  j < this->_nVProcs;  j++)
+		this->_traces[j].numBlocks = 0;
+	    return false;
+	}
+	this->_traces[index[i].vpId].numBlocks++;
     }
 
-  /* count the number of events per vproc */
-    uint64_t *nEvents = new uint64_t[hdr.nVProcs];
-    for (int i = 0;  i < hdr.nVProcs;  i++) {
-	nEvents[i] = 0;
+  /* fill in the tables; the index is sorted by vproc and then by time */
+    for (int i = 0;  i < this->_nVProcs;  i++) {
+	this->_traces[i].blocks = new LogBlock[this->_traces[i].numBlocks];
+	this->_traces[i].numBlocks = 0;
     }
-    LogBuffer_t *buf = static_cast<LogBuffer_t *>(addr);
-    for (int i = 0;  i < numBufs;  i++) {
-	int n = (buf[i].next > NEventsPerBuf) ? NEventsPerBuf : buf[i].next;
-	nEvents[buf[i].vpId] += n;
+    for (uint32_t i = 0;  i < footer->nEntries;  i++) {
+	VProcTrace *trace = &(this->_traces[index[i].vpId]);
+	LogBlock *blk = &(trace->blocks[trace->numBlocks++]);
+	blk->offset = index[i].offset;
+	blk->firstTS = Normalize(index[i].firstTS, this->_logStart);
+	blk->lastTS = Normalize(index[i].lastTS, this->_logStart);
     }
 
-  /* initialize the _traces */
-    Event *next[hdr.nVProcs];
-    this->_traces = new VProcTrace [hdr.nVProcs];
-    for (int i = 0;  i < hdr.nVProcs;  i++) {
-	nEvents[i] = 0;
-	this->_traces[i].vprocId = i;
-	this->_traces[i].cpuId = i;	// FIXME
-	this->_traces[i].numEvents = nEvents[i];
-	this->_traces[i].events = new Event [nEvents[i] + 2];
-	next[i] = this->_traces[i].events;
-	if (nEvents[i] == 0)
-	    fprintf (stderr, "warning: no events for VProc %d\n", i);
+    return true;
+}
+
+// initialize the block tables by scanning the buffer headers of the log file.
+// Only the first and last event of each buffer is examined.
+//
+bool LogFile::ScanBlocks (size_t fileSize)
+{
+    int numBufs = (fileSize / this->_bufSzB) - 1;
+    if (numBufs <= 0) {
+	fprintf(stderr, "no buffers in file\n");
+	return false;
     }
 
-  /* initialize the start sentinel in the event arrays */
-    EventAttrs *noEventAttrs = EventAttrsFactory (_filter.LogFileInfo(), 0);
-    for (int i = 0;  i < hdr.nVProcs;  i++) {
-	next[i]->ts = 0;
-	next[i]->attrs = noEventAttrs;
-	next[i]++;
+    char *base = static_cast<char *>(this->_addr);
+    for (int i = 0;  i < numBufs;  i++) {
+	LogBuffer_t *buf = reinterpret_cast<LogBuffer_t *>(base + (i+1) * this->_bufSzB);
+	if ((buf->vpId < (uint32_t)this->_nVProcs) && (buf->next > 0))
+	    this->_traces[buf->vpId].numBlocks++;
     }
 
-  /* initialize the events arrays */
+    for (int i = 0;  i < this->_nVProcs;  i++) {
+	this->_traces[i].blocks = new LogBlock[this->_traces[i].numBlocks];
+	this->_traces[i].numBlocks = 0;
+    }
     for (int i = 0;  i < numBufs;  i++) {
-	int vp = buf[i].vpId;
-	int n = (buf[i].next > NEventsPerBuf) ? NEventsPerBuf : buf[i].next;
-	for (int j = 0;  j < n;  j++) {
-	    LogEvent_t *lp = &(buf[i].log[j]);
-	    next[i]->ts = convertTime(lp->timestamp) - startTime;
-	    next[i]->attrs = EventAttrsFactory (this->_filter.LogFileInfo(), lp);
-	    next[i]++;
+	size_t offset = (i+1) * this->_bufSzB;
+	LogBuffer_t *buf = reinterpret_cast<LogBuffer_t *>(base + offset);
+	if ((buf->vpId < (uint32_t)this->_nVProcs) && (buf->next > 0)) {
+	    int n = (buf->next > this->_nEventsPerBuf) ? this->_nEventsPerBuf : buf->next;
+	    VProcTrace *trace = &(this->_traces[buf->vpId]);
+	    LogBlock *blk = &(trace->blocks[trace->numBlocks++]);
+	    blk->offset = offset;
+	    blk->firstTS = Normalize(this->_convertTime(buf->log[0].timestamp), this->_logStart);
+	    blk->lastTS = Normalize(this->_convertTime(buf->log[n-1].timestamp), this->_logStart);
 	}
     }
 
-  /* initialize the end sentinel in the event arrays */
-    Time_t endTime = 0;
-    for (int i = 0;  i < hdr.nVProcs;  i++) {
-	if (endTime < this->_traces[i].events[this->_traces[i].numEvents].ts)
-	    endTime = this->_traces[i].events[this->_traces[i].numEvents].ts;
-    }
-    for (int i = 0;  i < hdr.nVProcs;  i++) {
-	next[i]->ts = endTime;
-	next[i]->attrs = noEventAttrs;
+    return true;
+}
+
+// load the events in the window [start, end]
+//
+void LogFile::LoadWindow (Time_t start, Time_t end)
+{
+    if (this->_addr == 0)
+	return;  // no file loaded
+
+    LogFileDesc *lfd = this->_filter.LogFileInfo();
+    char *base = static_cast<char *>(this->_addr);
+
+  /* the attributes for the sentinels */
+    LogEvent_t noEvt;
+    noEvt.event = NoEvent;
+    EventAttrs *noEventAttrs = EventAttrsFactory (lfd, &noEvt);
+
+    for (int i = 0;  i < this->_nVProcs;  i++) {
+	VProcTrace *trace = &(this->_traces[i]);
+	trace->ClearEvents ();
+
+      /* find the blocks that overlap the window and count their events */
+	uint32_t firstBlk = trace->BlockByTimestamp (start);
+	uint32_t lastBlk = firstBlk;
+	uint64_t nEvents = 0;
+	while ((lastBlk < trace->numBlocks) && (trace->blocks[lastBlk].firstTS <= end)) {
+	    LogBuffer_t *buf = reinterpret_cast<LogBuffer_t *>(base + trace->blocks[lastBlk].offset);
+	    nEvents += (buf->next > this->_nEventsPerBuf) ? this->_nEventsPerBuf : buf->next;
+	    lastBlk++;
+	}
+
+	trace->events = new Event [nEvents + 2];
+	Event *next = trace->events;
+
+      /* initialize the start sentinel */
+	next->ts = start;
+	next->attrs = noEventAttrs;
+	next++;
+
+      /* decode the events in the window */
+	for (uint32_t b = firstBlk;  b < lastBlk;  b++) {
+	    LogBuffer_t *buf = reinterpret_cast<LogBuffer_t *>(base + trace->blocks[b].offset);
+	    int n = (buf->next > this->_nEventsPerBuf) ? this->_nEventsPerBuf : buf->next;
+	    for (int j = 0;  j < n;  j++) {
+		LogEvent_t *lp = &(buf->log[j]);
+		Time_t ts = Normalize(this->_convertTime(lp->timestamp), this->_logStart);
+		if ((start <= ts) && (ts <= end)) {
+		    next->ts = ts;
+		    next->attrs = EventAttrsFactory (lfd, lp);
+		    next++;
+		}
+	    }
+	}
+	trace->numEvents = next - trace->events - 1;
+
+      /* initialize the end sentinel */
+	next->ts = end;
+	next->attrs = noEventAttrs;
     }
 
   /* fill in information for intervals and dependent events */
 // FIXME
 
-    munmap (addr, szB);
-    fclose (f);
-
-    return true;
 }
 
 Event *LogFile::Get (uint32_t vpID, uint64_t index)
@@ -38,6 +38,10 @@ class EventAttrs {
     virtual TaggedArgValue Arg (int i) const;
     virtual ~EventAttrs ();
 
+  //! \brief return true if this object is shared by many events (and so must
+  //! not be deleted when an event is discarded).
+    virtual bool IsShared () const	{ return false; }
+
   protected:
     EventDesc	*_desc;
 
@@ -51,6 +55,7 @@ class SimpleEventAttrs : public EventAttrs {
   public:
     SimpleEventAttrs (EventDesc *d) : EventAttrs(d) { }
     ~SimpleEventAttrs () { }
+    bool IsShared () const		{ return true; }
 };
 
 //!\brief attributes for events that have kind #LOG_EVENT and have arguments.
@@ -110,15 +115,25 @@ struct Event {
     EventKind Kind() const		{ return this->Desc()->Kind(); }
 };
 
+//! \brief a block of events in the log file
+//
+struct LogBlock {
+    size_t		offset;		//!< \brief file offset of the block
+    Time_t		firstTS;	//!< \brief normalized timestamp of the block's first event
+    Time_t		lastTS;		//!< \brief normalized timestamp of the block's last event
+};
+
 //! \brief the sequence of events for a given vproc sorted in increasing-timestamp order
 //
 struct VProcTrace {
     uint32_t		vprocId;
     uint32_t		cpuId;
+    uint32_t		numBlocks;	//!< the number of blocks in the file for this vproc
+    LogBlock		*blocks;	//!< the vproc's blocks sorted by timestamp
     uint64_t		numEvents;	//!< the number of events in the array
-    Event		*events;	//!< the array of events sorted by timestamp.
-					//! there are numEvents+2 items in this array, with
-					//! sentinels at each end of the array.
+    Event		*events;	//!< the array of events in the current window sorted
+					//! by timestamp. there are numEvents+2 items in this
+					//! array, with sentinels at each end of the array.
 
   //! \brief return the timestamp of the first event in the array
     Time_t TimeOfFirstEvent () const	{ return this->events[1].ts; }
@@ -130,8 +145,14 @@ struct VProcTrace {
   //! \return the largest index i, such that events[i].ts <= t.
     int64_t IndexByTimestamp (Time_t t) const;
 
-    VProcTrace () { }
-    ~VProcTrace () { delete this->events; }
+  //! \brief return the index of the first block that contains events at or after \arg t
+    uint32_t BlockByTimestamp (Time_t t) const;
+
+  //! \brief free the events in the current window
+    void ClearEvents ();
+
+    VProcTrace () : numBlocks(0), blocks(0), numEvents(0), events(0) { }
+    ~VProcTrace () { this->ClearEvents();  delete[] this->blocks; }
 };
 
 //! \brief this class contains the log-file data from a single log file.
@@ -142,8 +163,14 @@ class LogFile {
     explicit LogFile (const char *logDescFileName);
     ~LogFile ();
 
+  //! \brief open a log file and load its block index.  Events are not decoded
+  //! until LoadWindow is called.
     bool LoadFile (const char *file);
 
+  //! \brief decode the events that fall in the window [\arg start, \arg end], replacing
+  //! the previously loaded window.  Only the blocks that overlap the window are read.
+    void LoadWindow (Time_t start, Time_t end);
+
     Event *Get (EventId_t id);
     Event *Get (uint32_t vpID, uint64_t index);
 
@@ -151,7 +178,17 @@ class LogFile {
     Time_t Duration () const { return this->_endTime - this->_startTime; }
 
   private:
+    bool LoadIndex (size_t fileSize);
+    bool ScanBlocks (size_t fileSize);
+
     int		_nVProcs;	//!< the number of VProcs in he run
+    void	*_addr;		//!< the memory-mapped log file
+    size_t	_mapSzB;	//!< the size of the mapping
+    size_t	_bufSzB;	//!< the size of log buffers in the file
+    int		_nEventsPerBuf;	//!< the maximum number of events per buffer
+    Time_t	(*_convertTime) (LogTS_t);
+				//!< convert log timestamps to nanoseconds
+    Time_t	_logStart;	//!< the run's start time (in nanoseconds)
     Time_t	_startTime;	//!< timestamp of the log's start
     Time_t	_endTime;	//!< timestamp of the log's end
     VProcTrace	*_traces;	//!< the event traces for each vproc.
@@ -9,17 +9,32 @@
  *   - The average and maximum time to attempt a steal.
  *   - Per-vproc time spent idle, busy and sleeping. Note that a vproc is considered idle
  *     while it is sleeping.
+ *   - Per-vproc time spent in each state of the work-stealing worker state group.
+ *
+ * The events are partitioned by vproc when the log is loaded.  All of the per-vproc
+ * statistics are computed in a single pass over each partition, and the partitions are
+ * processed in parallel by a pool of analysis threads (see the "-j" option).  The only
+ * information that crosses partitions is the position of the first WSTerminate event
+ * and the WSInit events, which reset every vproc's clock; both are computed up front.
  */
 
 //#include "manticore-config.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <assert.h>
+#include <vector>
+#include <algorithm>
 #include "log-file.h"
 #include "event-desc.hxx"
 #include "log-desc.hxx"
+#include "log-index.hxx"
 #include "default-log-paths.h"
 
 #define logDescFile	DEFAULT_LOG_EVENTS_PATH
@@ -38,21 +53,79 @@ struct Event {
 /*    uint32_t		data[5];	// upto 20 bytes of extra data */
 };
 
+/* the events of a single vproc sorted by timestamp */
+struct VProcEvents {
+    Event		*events;	// the vproc's events
+    int			nEvents;	// number of events
+};
+
+/* the position of an event in the global (timestamp, vproc ID) order of events */
+struct EventPos {
+    uint64_t		timestamp;
+    int32_t		vpId;
+};
+
+/* per-vproc results of the analysis */
+struct VProcStats {
+    int			numSteals;
+    int			numFailedStealAttempts;
+    uint64_t		totalTimeRebalancing;
+    int			numRebalances;
+    int			numEltsRebalanced;
+    uint64_t		avgTimeStealing;
+    uint64_t		maxTimeStealing;
+    uint64_t		timeBusy;
+    uint64_t		timeIdle;
+    uint64_t		timeSleeping;
+    uint64_t		*timeInState;	// time spent in each state of WorkerStates
+};
 
 LogFileHeader_t		*Hdr;		/* the file's header */
-Event			*Events;	/* an array of all of the events */
+VProcEvents		*VPEvents;	/* the events partitioned by vproc */
 int			NumEvents;	/* number of events */
+int			NumThreads;	/* number of analysis threads */
+
+/* the state group that tracks work-stealing workers (0 if there is none) and
+ * a table mapping event IDs to the state that the event transitions to (-1 if
+ * the event is not a transition).
+ */
+static StateGroup	*WorkerStates;
+static int		*WorkerTransition;
+
+/* information that crosses vproc partitions */
+static EventPos		TerminatePos;	/* the first WSTerminate event */
+static std::vector<EventPos> InitPos;	/* the WSInit events in order */
+static uint64_t		LastTimestamp;	/* the timestamp of the last event */
 
 static void LoadLogFile (LogFileDesc *logFileDesc, const char *file);
+static void FindWorkerStates (LogFileDesc *logFileDesc);
+static void AnalyzeVProc (int vpId, void *data);
+static void ParallelFor (int nTasks, void (*fn)(int, void *), void *data);
 static void PrintTimestamp (FILE *out, uint64_t timestamp);
 static void Usage (int sts);
 static inline uint64_t max (uint64_t x, uint64_t y) { return x < y ? y : x; }
 
+/* does the event at position p precede the event at position q? */
+static inline bool Precedes (EventPos p, EventPos q)
+{
+    return (p.timestamp < q.timestamp) || ((p.timestamp == q.timestamp) && (p.vpId < q.vpId));
+}
+
+static inline EventPos PosOf (Event *evt)
+{
+    EventPos pos = { evt->timestamp, evt->vpId };
+    return pos;
+}
+
 int main (int argc, const char **argv)
 {
     const char *logFile = DFLT_LOG_FILE;
     FILE *out = stdout;
 
+    NumThreads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (NumThreads < 1)
+	NumThreads = 1;
+
   // process args
     for (int i = 1;  i < argc; ) {
 	if (strcmp(argv[i], "-h") == 0) {
@@ -80,6 +153,19 @@ int main (int argc, const char **argv)
 		Usage (1);
 	    }
 	}
+	else if (strcmp(argv[i], "-j") == 0) {
+	    if (++i < argc) {
+		NumThreads = atoi(argv[i]); i++;
+		if (NumThreads < 1) {
+		    fprintf(stderr, "bogus number of threads for \"-j\" option\n");
+		    Usage (1);
+		}
+	    }
+	    else {
+		fprintf(stderr, "missing number for \"-j\" option\n");
+		Usage (1);
+	    }
+	}
 	else {
 	    fprintf(stderr, "invalid argument \"%s\"\n", argv[i]);
 	    Usage(1);
@@ -93,352 +179,100 @@ int main (int argc, const char **argv)
     }
 
     LoadLogFile (logFileDesc, logFile);
+    FindWorkerStates (logFileDesc);
 
-    /** check for bogus log data **/
-    bool foundInitFirst = false;
-
-    for (int i = 0; i < NumEvents; i++) {
-	if (foundInitFirst)
-	    break;
-	Event *evt = &(Events[i]);
-	int evtId = evt->desc->Id();
-	switch (evtId) {
-	case WSInitEvt:
-	    foundInitFirst = true;
-	    break;
-	case WSThiefSendEvt:
-	case WSThiefSuccessfulEvt:
-	case WSThiefUnsuccessfulEvt:
-	case WSExecuteEvt:
-	    printf ("Bogus log file: WSInitEvt was preceded by another WS* event.");
-	    exit (1);                 // WSInitEvt must precede all other work stealing events
-	}	
-    }
-
-  /** count the overall number of steals and failed steal attempts **/
-    int VProcNumSteals[Hdr->nVProcs];
-    int VProcNumFailedStealAttempts[Hdr->nVProcs];
-
-    {
-	bool IsTerminated = false;
-	for (int i = 0; i < Hdr->nVProcs; i++) {
-	    VProcNumSteals[i] = 0;
-	    VProcNumFailedStealAttempts[i] = 0;
-	}
-
-	for (int i = 0; i < NumEvents; i++) {
-	    Event *evt = &(Events[i]);
-	    if (evt->desc->Id() == WSThiefSuccessfulEvt) {
-		VProcNumSteals[evt->vpId]++;
-	    }
-	    else if (evt->desc->Id() == WSThiefUnsuccessfulEvt) {
-		VProcNumFailedStealAttempts[evt->vpId]++;
-	    } else if (evt->desc->Id() == WSTerminateEvt) {
-		break;
-	    }
-	}
-    }
-
-    uint64_t TotalTimeRebalancing[Hdr->nVProcs];
-    int NumRebalances[Hdr->nVProcs];
-    int NumEltsRebalanced[Hdr->nVProcs];
-    {
-	uint64_t VProcTimestamp[Hdr->nVProcs];          // timestamp of immediately preceding, relevant event 
-	
-	for (int i = 0; i < Hdr->nVProcs; i++) {
-	    VProcTimestamp[i] = 0ul;
-	    NumRebalances[i] = 0;
-	    TotalTimeRebalancing[i] = 0ul;
-	    NumEltsRebalanced[i] = 0;
-	}
-
-	for (int i = 0; i < NumEvents; i++) {
-	    Event *evt = &(Events[i]);
-	    int evtId = evt->desc->Id();
-	    switch (evtId) {
-	    case RopeRebalanceBeginEvt:
-		{
-		    const ArgDesc *arg = evt->desc->Args();
-		    NumEltsRebalanced[evt->vpId] += arg->loc;
-		    VProcTimestamp[evt->vpId] = evt->timestamp;
-		    break;
-		}
-	    case RopeRebalanceEndEvt:
-		uint64_t timeRebalancing = evt->timestamp - VProcTimestamp[evt->vpId];
-		TotalTimeRebalancing[evt->vpId] += timeRebalancing;
-		NumRebalances[evt->vpId]++;
-		break;
-	    }
-	}
-    }
-
-  /** measure the average and max time spent stealing (per vproc) **/
-    uint64_t AvgTimeStealing[Hdr->nVProcs];
-    uint64_t MaxTimeStealing[Hdr->nVProcs];
-    {
-	bool IsTerminated = false;
-	uint64_t VProcTimestamp[Hdr->nVProcs];          // timestamp of immediately preceding, relevant event 
-	uint64_t TotalTimeStealing[Hdr->nVProcs];       // total time spent stealing so far
-	uint64_t NumStealAttempts[Hdr->nVProcs];
-
-	for (int i = 0; i < Hdr->nVProcs; i++) {
-	    AvgTimeStealing[i] = 0ul;
-	    MaxTimeStealing[i] = 0ul;
-	    VProcTimestamp[i] = 0ul;
-	    TotalTimeStealing[i] = 0ul;
-	    NumStealAttempts[i] = 0ul;
-	}
-
-	for (int i = 0; i < NumEvents; i++) {
-	    if (IsTerminated)
-		break;
-
-	    Event *evt = &(Events[i]);
-	    int evtId = evt->desc->Id();
-	    switch (evtId) {
-	    case WSTerminateEvt:
-		IsTerminated = true;
-		break;
-	    case WSThiefSendEvt:
-		VProcTimestamp[evt->vpId] = evt->timestamp;
-		break;
-	    case WSThiefSuccessfulEvt:
-	    case WSThiefUnsuccessfulEvt:
-		{
-		    if (VProcTimestamp[evt->vpId] == 0ul) {
-			printf ("bug: steal event preceding a send event...\n");
-			continue;
-		    }
-		    uint64_t timeStealing = evt->timestamp - VProcTimestamp[evt->vpId];
-		    TotalTimeStealing[evt->vpId] += timeStealing;
-		    MaxTimeStealing[evt->vpId] = max(MaxTimeStealing[evt->vpId], timeStealing);
-		    NumStealAttempts[evt->vpId]++;
-		}
-		break;
-	    }
-	}
-
-	for (int i = 0; i < Hdr->nVProcs; i++) 
-	    if (NumStealAttempts[i] != 0)
-		AvgTimeStealing[i] = TotalTimeStealing[i] / NumStealAttempts[i];
-
-    }
-
-  /** measure the time spent either busy or idle (per vproc) **/
-    uint64_t VProcTimeBusy[Hdr->nVProcs];
-    uint64_t VProcTimeIdle[Hdr->nVProcs];
+  /** find the events that cross vproc partitions and check for bogus log data **/
     {
-	bool     IsTerminated = false;            // true, if the computation has finished
-	bool     VProcIdle[Hdr->nVProcs];         // true, if the vproc is currently idle
-	bool     VProcTerminated[Hdr->nVProcs];   // true, if the vproc terminated cleanly
-	uint64_t VProcTimestamp[Hdr->nVProcs];    // timestamp of immediately preceding event
-	uint32_t LastEvent = 0;             // index of the last event to be measured during the execution of work stealing
-	
-	for (int i = 0; i < Hdr->nVProcs; i++) {
-	    VProcIdle[i] = true;
-	    VProcTerminated[i] = false;
-	    VProcTimestamp[i] = 0ul;
-	    VProcTimeBusy[i] = 0ul;
-	    VProcTimeIdle[i] = 0ul;
-	}
-	
-	for (int i = 0; i < NumEvents; i++) {
-	    LastEvent = i;
-	    if (IsTerminated)
-		break;
-
-	    Event *evt = &(Events[i]);
-	    int evtId = evt->desc->Id();
-	    switch (evtId) {
-	    case WSInitEvt:
-		{
-		  /* we mark vprocs as idle right after the workgroup is created */
-		    for (int j = 0; j < Hdr->nVProcs; j++)
-			VProcTimestamp[j] = evt->timestamp;
-		}
-		break;
-	    case WSTerminateEvt:
-		{
-		    if (VProcIdle[evt->vpId])
-			VProcTimeBusy[evt->vpId] += evt->timestamp - VProcTimestamp[evt->vpId];
-		    else
-			VProcTimeIdle[evt->vpId] += evt->timestamp - VProcTimestamp[evt->vpId];
-		    VProcTerminated[evt->vpId] = true;
-		}
-		break;
-	    case WSExecuteEvt:
-		{
-		    if (VProcTimestamp[evt->vpId] == 0ul) {
-			// we fudge a bit here to deal with clock skew
-			VProcTimestamp[evt->vpId] = evt->timestamp;
-		    } 
-		    else if (VProcIdle[evt->vpId]) {
-			VProcTimeIdle[evt->vpId] += evt->timestamp - VProcTimestamp[evt->vpId];
-			VProcTimestamp[evt->vpId] = evt->timestamp;
-		    } 
-		    else {
-			// already busy
+	EventPos firstWSEvt = { UINT64_MAX, INT32_MAX };
+	int firstWSEvtId = -1;
+	TerminatePos.timestamp = UINT64_MAX;
+	TerminatePos.vpId = INT32_MAX;
+	LastTimestamp = 0;
+	for (int vp = 0;  vp < Hdr->nVProcs;  vp++) {
+	    Event *evts = VPEvents[vp].events;
+	    int n = VPEvents[vp].nEvents;
+	    bool foundWSEvt = false;
+	    bool foundTerminate = false;
+	    if (n > 0)
+		LastTimestamp = max(LastTimestamp, evts[n-1].timestamp);
+	    for (int i = 0;  i < n;  i++) {
+		Event *evt = &(evts[i]);
+		switch (evt->desc->Id()) {
+		  case WSInitEvt:
+		    InitPos.push_back (PosOf(evt));
+		  // fall through
+		  case WSThiefSendEvt:
+		  case WSThiefSuccessfulEvt:
+		  case WSThiefUnsuccessfulEvt:
+		  case WSExecuteEvt:
+		    if (!foundWSEvt) {
+			foundWSEvt = true;
+			if (Precedes(PosOf(evt), firstWSEvt)) {
+			    firstWSEvt = PosOf(evt);
+			    firstWSEvtId = evt->desc->Id();
+			}
 		    }
-		    VProcIdle[evt->vpId] = false;
-		}
-		break;
-	    case WSPreemptedEvt:
-	    case WSThiefSendEvt:
-		{
-		    if (VProcTimestamp[evt->vpId] == 0ul) {
-			// we fudge a bit here to deal with clock skew
-			VProcTimestamp[evt->vpId] = evt->timestamp;
-		    }
-		    else if (!VProcIdle[evt->vpId]) {
-			VProcTimeBusy[evt->vpId] += evt->timestamp - VProcTimestamp[evt->vpId];
-			VProcTimestamp[evt->vpId] = evt->timestamp;
-		    } 
-		    else {
-			// already idle
+		    break;
+		  case WSTerminateEvt:
+		    if (!foundTerminate) {
+			foundTerminate = true;
+			if (Precedes(PosOf(evt), TerminatePos))
+			    TerminatePos = PosOf(evt);
 		    }
-		    VProcIdle[evt->vpId] = true;		    
+		    break;
 		}
-		break;
 	    }
 	}
-
-      /* account for any remaining time in case the vproc did not shut down explicitly */
-	Event *lastEvt = &(Events[LastEvent]);
-	/*
-	for (int i = 0; i < Hdr->nVProcs; i++) {
-	    if (!VProcTerminated[i]) {
-		if (VProcIdle[i])
-		    VProcTimeIdle[i] += lastEvt->timestamp - VProcTimestamp[i];
-		else
-		    VProcTimeBusy[i] += lastEvt->timestamp - VProcTimestamp[i];
-	    }
+	if ((firstWSEvtId >= 0) && (firstWSEvtId != WSInitEvt)) {
+	    printf ("Bogus log file: WSInitEvt was preceded by another WS* event.");
+	    exit (1);                 // WSInitEvt must precede all other work stealing events
 	}
-	*/
+	std::sort (InitPos.begin(), InitPos.end(), Precedes);
     }
 
-  /** measure the time spent sleeping **/
-    uint64_t VProcTimeSleeping[Hdr->nVProcs];
-    {
-	bool     IsTerminated = false;
-	bool     VProcSleeping[Hdr->nVProcs];           // true, if the vproc
-	bool     VProcTerminated[Hdr->nVProcs];         // true, if the vproc terminated cleanly
-	uint64_t VProcTimestamp[Hdr->nVProcs];          // timestamp of immediately preceding, relevant event 
-
-	for (int i = 0; i < Hdr->nVProcs; i++) {
-	    VProcSleeping[i] = false;
-	    VProcTerminated[i] = false;
-	    VProcTimestamp[i] = 0ul;
-	    VProcTimeSleeping[i] = 0ul;
-	}
-
-	for (int i = 0; i < NumEvents; i++) {
-	    if (IsTerminated)
-		break;
-
-	    Event *evt = &(Events[i]);
-	    int evtId = evt->desc->Id();
-	    switch (evtId) {
-	    case WSInitEvt:
-		{
-		    for (int j = 0; j < Hdr->nVProcs; j++)
-			VProcTimestamp[j] = evt->timestamp;
-		}
-		break;
-	    case WSTerminateEvt:
-		{
-		    if (VProcSleeping[evt->vpId])
-			VProcTimeSleeping[evt->vpId] += evt->timestamp - VProcTimestamp[evt->vpId];
-		    IsTerminated = true;
-		    VProcTerminated[evt->vpId] = true;
-		}
-		break;
-	    case WSExecuteEvt:
-		{
-		    if (VProcTimestamp[evt->vpId] == 0ul) {
-			// fudge a bit here to deal with clock skew
-		    }
-		    else if (VProcSleeping[evt->vpId]) {
-			VProcTimeSleeping[evt->vpId] += evt->timestamp - VProcTimestamp[evt->vpId];
-		    } 
-		    else {
-			// already busy
-		    }
-		    VProcSleeping[evt->vpId] = false;
-		}
-		break;
-	    case WSPreemptedEvt:
-	    case WSThiefSendEvt:
-		{
-		    if (VProcTimestamp[evt->vpId] == 0ul) {
-			// fudge a bit here to deal with clock skew
-		    }
-		    else if (VProcSleeping[evt->vpId]) {
-			VProcTimeSleeping[evt->vpId] += evt->timestamp - VProcTimestamp[evt->vpId];
-		    } 
-		    else {
-			// already idle
-		    }
-		    VProcSleeping[evt->vpId] = false;
-		}
-		break;
-	    case WSSleepEvt:
-		{
-		    VProcTimestamp[evt->vpId] = evt->timestamp;
-		    VProcSleeping[evt->vpId] = true;
-		}
-		break;
-	    }
-	}
-
-      /* account for any remaining time in case the vproc did not shut down explicitly */
-	Event *lastEvt = &(Events[NumEvents-1]);
-	for (int i = 0; i < Hdr->nVProcs; i++) {
-	    if (!VProcTerminated[i]) {
-		if (VProcSleeping[i])
-		    VProcTimeSleeping[i] += lastEvt->timestamp - VProcTimestamp[i];
-	    }
-	}
-    }
+  /** compute the per-vproc statistics **/
+    VProcStats *stats = new VProcStats[Hdr->nVProcs];
+    ParallelFor (Hdr->nVProcs, AnalyzeVProc, stats);
 
     fprintf (out, "{\n");
     fprintf (out, "numVProcs=%d,\n", Hdr->nVProcs);
     fprintf (out, "clock=\"%s\",\n", Hdr->clockName);
     fprintf (out, "numSteals=\n");
-    fprintf (out, "[");    
+    fprintf (out, "[");
     for (int i = 0; i < Hdr->nVProcs; i++) {
-	fprintf (out, " %d", VProcNumSteals[i]);
+	fprintf (out, " %d", stats[i].numSteals);
 	if (i < Hdr->nVProcs - 1)
-	    fprintf (out, ",");	    
+	    fprintf (out, ",");
 	else
 	    fprintf (out, "],\n");
     }
     fprintf (out, "numFailedStealAttempts=\n");
-    fprintf (out, "[");    
+    fprintf (out, "[");
     for (int i = 0; i < Hdr->nVProcs; i++) {
-	fprintf (out, " %d", VProcNumFailedStealAttempts[i]);
+	fprintf (out, " %d", stats[i].numFailedStealAttempts);
 	if (i < Hdr->nVProcs - 1)
 	    fprintf (out, ",");
 	else
 	    fprintf (out, "],\n");
     }
     fprintf (out, "vprocState=\n");
-    fprintf (out, "[\n");    
+    fprintf (out, "[\n");
     for (int i = 0; i < Hdr->nVProcs; i++) {
 	fprintf (out, " {timeBusy=");
-	PrintTimestamp (out, VProcTimeBusy[i]);
+	PrintTimestamp (out, stats[i].timeBusy);
 	fprintf (out, " ,");
 	fprintf (out, " timeIdle=");
-	PrintTimestamp (out, VProcTimeIdle[i]);
+	PrintTimestamp (out, stats[i].timeIdle);
 	fprintf (out, " ,");
 	fprintf (out, " timeSleeping=");
-	PrintTimestamp (out, VProcTimeSleeping[i]);
+	PrintTimestamp (out, stats[i].timeSleeping);
 	fprintf (out, " ,");
 	fprintf (out, " timeRebalancing=");
-	PrintTimestamp (out, TotalTimeRebalancing[i]);
+	PrintTimestamp (out, stats[i].totalTimeRebalancing);
 	fprintf (out, " ,");
-	fprintf (out, " numEltsRebalanced=%d", NumEltsRebalanced[i]);
+	fprintf (out, " numEltsRebalanced=%d", stats[i].numEltsRebalanced);
 	fprintf (out, " ,");
-	fprintf (out, " numRebalances=%d", NumRebalances[i]);
+	fprintf (out, " numRebalances=%d", stats[i].numRebalances);
 	if (i < Hdr->nVProcs - 1)
 	    fprintf (out, " },\n");
 	else
@@ -446,32 +280,330 @@ int main (int argc, const char **argv)
     }
     fprintf (out, "],\n");
     fprintf (out, "timeStealing=\n");
-    fprintf (out, "[\n");    
+    fprintf (out, "[\n");
     for (int i = 0; i < Hdr->nVProcs; i++) {
 	fprintf (out, " {avg=");
-	PrintTimestamp (out, AvgTimeStealing[i]);
+	PrintTimestamp (out, stats[i].avgTimeStealing);
 	fprintf (out, " ,");
 	fprintf (out, " max=");
-	PrintTimestamp (out, MaxTimeStealing[i]);
+	PrintTimestamp (out, stats[i].maxTimeStealing);
 	if (i < Hdr->nVProcs - 1)
 	    fprintf (out, " },\n");
 	else
 	    fprintf (out, " }\n");
     }
-    fprintf (out, "]\n");
+    if (WorkerStates == 0) {
+	fprintf (out, "]\n");
+    }
+    else {
+	fprintf (out, "],\n");
+	fprintf (out, "workerStates=\n");
+	fprintf (out, "[");
+	for (int s = 0;  s < WorkerStates->NumStates();  s++) {
+	    fprintf (out, " \"%s\"", WorkerStates->StateName(s));
+	    if (s < WorkerStates->NumStates() - 1)
+		fprintf (out, ",");
+	    else
+		fprintf (out, "],\n");
+	}
+	fprintf (out, "timeInWorkerState=\n");
+	fprintf (out, "[\n");
+	for (int i = 0; i < Hdr->nVProcs; i++) {
+	    fprintf (out, " [");
+	    for (int s = 0;  s < WorkerStates->NumStates();  s++) {
+		PrintTimestamp (out, stats[i].timeInState[s]);
+		if (s < WorkerStates->NumStates() - 1)
+		    fprintf (out, " ,");
+	    }
+	    if (i < Hdr->nVProcs - 1)
+		fprintf (out, " ],\n");
+	    else
+		fprintf (out, " ]\n");
+	}
+	fprintf (out, "]\n");
+    }
     fprintf (out, "}\n");
 }
 
-/* compare function for events */
-int CompareEvent (const void *ev1, const void *ev2)
+/* AnalyzeVProc:
+ *
+ * Compute the statistics for a single vproc in one pass over its events.  The
+ * WSInit events of the other vprocs are merged into the pass, since they reset
+ * this vproc's clock too.  Events that follow the first WSTerminate event (in the
+ * global order) are ignored by all but the busy/idle, rebalancing and worker-state
+ * accounting.
+ */
+static void AnalyzeVProc (int vpId, void *data)
+{
+    VProcStats *st = &(((VProcStats *)data)[vpId]);
+    Event *evts = VPEvents[vpId].events;
+    int nEvts = VPEvents[vpId].nEvents;
+
+  // steal counts, rebalancing and steal latency
+    int numSteals = 0;
+    int numFailedStealAttempts = 0;
+    uint64_t rebalanceTimestamp = 0ul;	// timestamp of the last RopeRebalanceBegin event
+    uint64_t totalTimeRebalancing = 0ul;
+    int numRebalances = 0;
+    int numEltsRebalanced = 0;
+    uint64_t sendTimestamp = 0ul;	// timestamp of the last WSThiefSend event
+    uint64_t totalTimeStealing = 0ul;	// total time spent stealing so far
+    uint64_t maxTimeStealing = 0ul;
+    uint64_t numStealAttempts = 0ul;
+  // busy/idle accounting
+    bool isIdle = true;			// true, if the vproc is currently idle
+    uint64_t busyTimestamp = 0ul;	// timestamp of the immediately preceding busy/idle event
+    uint64_t timeBusy = 0ul;
+    uint64_t timeIdle = 0ul;
+  // sleep accounting
+    bool isSleeping = false;		// true, if the vproc is currently sleeping
+    bool isTerminated = false;		// true, if the vproc terminated cleanly
+    uint64_t sleepTimestamp = 0ul;	// timestamp of the immediately preceding sleep event
+    uint64_t timeSleeping = 0ul;
+  // worker-state accounting
+    int state = (WorkerStates != 0) ? WorkerStates->StartState() : 0;
+    uint64_t stateTimestamp = 0ul;
+    if (WorkerStates != 0) {
+	st->timeInState = new uint64_t[WorkerStates->NumStates()];
+	for (int s = 0;  s < WorkerStates->NumStates();  s++)
+	    st->timeInState[s] = 0ul;
+    }
+    else
+	st->timeInState = 0;
+
+    unsigned int nextInit = 0;
+    for (int i = 0;  i < nEvts; ) {
+      /* first process the WSInit events of other vprocs that precede this event; our
+       * own WSInit events are handled below, in order with the rest of our events.
+       */
+	if ((nextInit < InitPos.size())
+	&& ((InitPos[nextInit].vpId == vpId) || Precedes(InitPos[nextInit], PosOf(&(evts[i]))))) {
+	    EventPos init = InitPos[nextInit++];
+	    if (init.vpId != vpId) {
+		busyTimestamp = init.timestamp;
+		if (! Precedes(TerminatePos, init))
+		    sleepTimestamp = init.timestamp;
+	    }
+	    continue;
+	}
+
+	Event *evt = &(evts[i++]);
+	int evtId = evt->desc->Id();
+      /* true if the event is at or before the first WSTerminate event */
+	bool beforeTerm = ! Precedes(TerminatePos, PosOf(evt));
+
+	if ((WorkerStates != 0) && (WorkerTransition[evtId] >= 0)) {
+	    st->timeInState[state] += evt->timestamp - stateTimestamp;
+	    state = WorkerTransition[evtId];
+	    stateTimestamp = evt->timestamp;
+	}
+
+	switch (evtId) {
+	  case WSInitEvt:
+	  /* we mark vprocs as idle right after the workgroup is created */
+	    busyTimestamp = evt->timestamp;
+	    if (beforeTerm)
+		sleepTimestamp = evt->timestamp;
+	    break;
+	  case WSTerminateEvt:
+	    if (isIdle)
+		timeBusy += evt->timestamp - busyTimestamp;
+	    else
+		timeIdle += evt->timestamp - busyTimestamp;
+	    if (beforeTerm) {
+		if (isSleeping)
+		    timeSleeping += evt->timestamp - sleepTimestamp;
+		isTerminated = true;
+	    }
+	    break;
+	  case WSExecuteEvt:
+	    if (busyTimestamp == 0ul) {
+	      // we fudge a bit here to deal with clock skew
+		busyTimestamp = evt->timestamp;
+	    }
+	    else if (isIdle) {
+		timeIdle += evt->timestamp - busyTimestamp;
+		busyTimestamp = evt->timestamp;
+	    }
+	    isIdle = false;
+	    if (beforeTerm) {
+		if ((sleepTimestamp != 0ul) && isSleeping)
+		    timeSleeping += evt->timestamp - sleepTimestamp;
+		isSleeping = false;
+	    }
+	    break;
+	  case WSThiefSendEvt:
+	    if (beforeTerm)
+		sendTimestamp = evt->timestamp;
+	  // fall through
+	  case WSPreemptedEvt:
+	    if (busyTimestamp == 0ul) {
+	      // we fudge a bit here to deal with clock skew
+		busyTimestamp = evt->timestamp;
+	    }
+	    else if (!isIdle) {
+		timeBusy += evt->timestamp - busyTimestamp;
+		busyTimestamp = evt->timestamp;
+	    }
+	    isIdle = true;
+	    if (beforeTerm) {
+		if ((sleepTimestamp != 0ul) && isSleeping)
+		    timeSleeping += evt->timestamp - sleepTimestamp;
+		isSleeping = false;
+	    }
+	    break;
+	  case WSThiefSuccessfulEvt:
+	  case WSThiefUnsuccessfulEvt:
+	    if (beforeTerm) {
+		if (evtId == WSThiefSuccessfulEvt)
+		    numSteals++;
+		else
+		    numFailedStealAttempts++;
+		if (sendTimestamp == 0ul) {
+		    printf ("bug: steal event preceding a send event...\n");
+		    break;
+		}
+		uint64_t timeStealing = evt->timestamp - sendTimestamp;
+		totalTimeStealing += timeStealing;
+		maxTimeStealing = max(maxTimeStealing, timeStealing);
+		numStealAttempts++;
+	    }
+	    break;
+	  case WSSleepEvt:
+	    if (beforeTerm) {
+		sleepTimestamp = evt->timestamp;
+		isSleeping = true;
+	    }
+	    break;
+	  case RopeRebalanceBeginEvt:
+	    {
+		const ArgDesc *arg = evt->desc->Args();
+		numEltsRebalanced += arg->loc;
+		rebalanceTimestamp = evt->timestamp;
+	    }
+	    break;
+	  case RopeRebalanceEndEvt:
+	    totalTimeRebalancing += evt->timestamp - rebalanceTimestamp;
+	    numRebalances++;
+	    break;
+	}
+    }
+
+  /* account for any remaining time in case the vproc did not shut down explicitly */
+    if (!isTerminated && isSleeping)
+	timeSleeping += LastTimestamp - sleepTimestamp;
+    if (WorkerStates != 0)
+	st->timeInState[state] += LastTimestamp - stateTimestamp;
+
+    st->numSteals = numSteals;
+    st->numFailedStealAttempts = numFailedStealAttempts;
+    st->totalTimeRebalancing = totalTimeRebalancing;
+    st->numRebalances = numRebalances;
+    st->numEltsRebalanced = numEltsRebalanced;
+    st->avgTimeStealing = (numStealAttempts != 0) ? totalTimeStealing / numStealAttempts : 0ul;
+    st->maxTimeStealing = maxTimeStealing;
+    st->timeBusy = timeBusy;
+    st->timeIdle = timeIdle;
+    st->timeSleeping = timeSleeping;
+
+}
+
+/* FindWorkerStates:
+ *
+ * Find the state group that describes the status of work-stealing workers (i.e., the
+ * one with a transition on WSExecute) and precompute its transition table, so that the
+ * analysis threads do not have to search the group's transitions for every event.
+ */
+static void FindWorkerStates (LogFileDesc *logFileDesc)
 {
-    int64_t t = (int64_t)((Event *)ev1)->timestamp - (int64_t)((Event *)ev2)->timestamp;
-    if (t == 0) return (((Event *)ev1)->vpId - ((Event *)ev2)->vpId);
-    else if (t < 0) return -1;
-    else return 1;
+    class Visitor : public LogDescVisitor {
+      public:
+	Visitor (EventDesc *evt) : _evt(evt), _grp(0) { }
+	void VisitGroup (EventGroup *) { }
+	void VisitStateGroup (StateGroup *grp)
+	{
+	    if ((this->_grp == 0) && grp->containsEvent(this->_evt))
+		this->_grp = grp;
+	}
+	void VisitIntervalGroup (IntervalGroup *) { }
+	void VisitDependentGroup (DependentGroup *) { }
+	StateGroup *Group () const { return this->_grp; }
+      private:
+	EventDesc	*_evt;
+	StateGroup	*_grp;
+    };
+
+    Visitor v(logFileDesc->FindEventById(WSExecuteEvt));
+    logFileDesc->PreOrderWalk (&v);
+    WorkerStates = v.Group();
+
+    if (WorkerStates != 0) {
+	int nKinds = logFileDesc->NumEventKinds();
+	WorkerTransition = new int[nKinds];
+	for (int id = 0;  id < nKinds;  id++)
+	    WorkerTransition[id] = WorkerStates->NextState(
+		WorkerStates->StartState(), logFileDesc->FindEventById(id));
+    }
+
+}
+
+/***** Parallel loops *****/
+
+struct ParallelForInfo {
+    int			nTasks;
+    int volatile	nextTask;	// the next unclaimed task
+    void		(*fn) (int, void *);
+    void		*data;
+};
+
+static void *ParallelForWorker (void *arg)
+{
+    ParallelForInfo *info = (ParallelForInfo *)arg;
+    int i;
+
+    while ((i = __sync_fetch_and_add(&(info->nextTask), 1)) < info->nTasks)
+	info->fn (i, info->data);
+
+    return 0;
+}
+
+/* ParallelFor:
+ *
+ * Apply fn to the task indices 0..nTasks-1 using up to NumThreads threads (including
+ * the calling thread).  Tasks are claimed dynamically, so uneven tasks are balanced.
+ */
+static void ParallelFor (int nTasks, void (*fn)(int, void *), void *data)
+{
+    ParallelForInfo info;
+    info.nTasks = nTasks;
+    info.nextTask = 0;
+    info.fn = fn;
+    info.data = data;
+
+    int nThreads = (NumThreads < nTasks) ? NumThreads : nTasks;
+    pthread_t *tids = new pthread_t[nThreads];
+    int nStarted = 0;
+    for (int t = 1;  t < nThreads;  t++) {
+	if (pthread_create (&(tids[nStarted]), 0, ParallelForWorker, &info) == 0)
+	    nStarted++;
+    }
+
+    ParallelForWorker (&info);
+
+    for (int t = 0;  t < nStarted;  t++)
+	pthread_join (tids[t], 0);
+    delete[] tids;
 
 }
 
+/***** Loading the log file *****/
+
+/* compare function for events of the same vproc */
+static bool EarlierEvent (const Event &ev1, const Event &ev2)
+{
+    return (ev1.timestamp < ev2.timestamp);
+}
+
 /* convert a timestamp to nanoseconds */
 static inline uint64_t GetTimestamp (LogTS_t *ts)
 {
@@ -483,10 +615,74 @@ static inline uint64_t GetTimestamp (LogTS_t *ts)
 	return ts->ts_val.sec * 1000000000 + ts->ts_val.frac * 1000;
 }
 
-static void LoadLogFile (LogFileDesc *logFileDesc, const char *file)
+/* the state shared by the loading tasks */
+struct LoadInfo {
+    LogFileDesc		*logFileDesc;
+    char		*base;		// the mapped file
+    int			numBufs;	// the number of buffers in the file
+    int			*bufStart;	// index of each buffer's first event in its vproc's partition
+    uint64_t		startTime;	// the start time of the run
+};
+
+/* the number of buffers decoded by a single task */
+#define BUFS_PER_TASK	64
+
+static inline LogBuffer_t *GetLogBuffer (LoadInfo *info, int i)
+{
+    return (LogBuffer_t *)(info->base + (size_t)(i+1) * LogBufSzB);
+}
+
+static inline int NumBufEvents (LogBuffer_t *log)
+{
+    if (log->next > NEventsPerBuf)
+	return NEventsPerBuf;
+    else if (log->next < 0)
+	return 0;
+    else
+	return log->next;
+}
+
+/* decode the events in a range of buffers into their vprocs' partitions */
+static void DecodeBuffers (int task, void *data)
+{
+    LoadInfo *info = (LoadInfo *)data;
+    int lo = task * BUFS_PER_TASK;
+    int hi = (lo + BUFS_PER_TASK < info->numBufs) ? lo + BUFS_PER_TASK : info->numBufs;
+
+    for (int i = lo;  i < hi;  i++) {
+	LogBuffer_t *log = GetLogBuffer (info, i);
+	Event *ep = &(VPEvents[log->vpId].events[info->bufStart[i]]);
+	int n = NumBufEvents (log);
+	for (int j = 0;  j < n;  j++, ep++) {
+	    LogEvent_t *lp = &(log->log[j]);
+	  /* extract event and data fields */
+	    ep->timestamp = GetTimestamp(&(lp->timestamp));
+	    ep->vpId = log->vpId;
+	    ep->desc = info->logFileDesc->FindEventById (lp->event);
+/* FIXME: skip data for now */
+	}
+    }
+
+}
+
+/* sort the events of a vproc by timestamp */
+static void SortVProcEvents (int vpId, void *data)
 {
-    char	*buf = new char[LOGBLOCK_SZB];
+    VProcEvents *vp = &(VPEvents[vpId]);
+    std::stable_sort (vp->events, vp->events + vp->nEvents, EarlierEvent);
+}
 
+/* adjust the timestamps of a vproc's events to be relative to the start of the run */
+static void AdjustVProcEvents (int vpId, void *data)
+{
+    LoadInfo *info = (LoadInfo *)data;
+    VProcEvents *vp = &(VPEvents[vpId]);
+    for (int i = 0;  i < vp->nEvents;  i++)
+	vp->events[i].timestamp -= info->startTime;
+}
+
+static void LoadLogFile (LogFileDesc *logFileDesc, const char *file)
+{
   /* get the file size */
     off_t fileSize;
     {
@@ -497,18 +693,27 @@ static void LoadLogFile (LogFileDesc *logFileDesc, const char *file)
 	}
 	fileSize = st.st_size;
     }
+    if (fileSize < LOGBLOCK_SZB) {
+	fprintf(stderr, "no header in file\n");
+	exit (1);
+    }
 
-  /* open the file */
-    FILE *f = fopen(file, "rb");
-    if (f == NULL) {
-	perror ("fopen");
+  /* map the file */
+    int fd = open(file, O_RDONLY);
+    if (fd < 0) {
+	perror ("open");
 	exit (1);
     }
+    char *base = (char *)mmap(0, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED) {
+	perror ("mmap");
+	exit (1);
+    }
+    close (fd);
 
   /* read the header */
-    fread (buf, LOGBLOCK_SZB, 1, f);
     Hdr = new LogFileHeader_t;
-    memcpy (Hdr, buf, sizeof(LogFileHeader_t));
+    memcpy (Hdr, base, sizeof(LogFileHeader_t));
 
   /* check the header */
     if (Hdr->magic != LOG_MAGIC) {
@@ -530,60 +735,69 @@ static void LoadLogFile (LogFileDesc *logFileDesc, const char *file)
       // recompute the sizes
 	LogBufSzB = Hdr->bufSzB;
 	NEventsPerBuf = (LogBufSzB / sizeof(LogEvent_t)) - 1;
-      // reallocate the input buffer
-	delete buf;
-	buf = new char[LogBufSzB];
-      // reset the input file pointer
-	if (fseek(f, LogBufSzB, SEEK_SET) == -1) {
-	    perror ("fseek");
-	    exit (1);
-	}
     }
 
-    int numBufs = (fileSize / LogBufSzB) - 1;
+  /* the block index at the end of the file (if any) does not hold events */
+    int numBufs = (LogDataSize (file, fileSize) / LogBufSzB) - 1;
     if (numBufs <= 0) {
 	fprintf(stderr, "no buffers in file\n");
 	exit (1);
     }
 
-    int MaxNumEvents = NEventsPerBuf*numBufs;
-    Events = new Event[MaxNumEvents];
-    NumEvents = 0;
+    LoadInfo info;
+    info.logFileDesc = logFileDesc;
+    info.base = base;
+    info.numBufs = numBufs;
+    info.bufStart = new int[numBufs];
 
-  /* read in the events */
+  /* size the vproc partitions; this pass only touches the buffer headers */
+    VPEvents = new VProcEvents[Hdr->nVProcs];
+    for (int vp = 0;  vp < Hdr->nVProcs;  vp++)
+	VPEvents[vp].nEvents = 0;
+    NumEvents = 0;
     for (int i = 0;  i < numBufs;  i++) {
-	fread (buf, LogBufSzB, 1, f);
-	LogBuffer_t *log = (LogBuffer_t *)buf;
-	if (log->next > NEventsPerBuf)
-	    log->next = NEventsPerBuf;
-	for (int j = 0;  j < log->next;  j++) {
-	    assert (NumEvents < MaxNumEvents);
-	    LogEvent_t *lp = &(log->log[j]);
-	    Event *ep = &(Events[NumEvents++]);
-	  /* extract event and data fields */
-	    ep->timestamp = GetTimestamp(&(lp->timestamp));
-	    ep->vpId = log->vpId;
-	    ep->desc = logFileDesc->FindEventById (lp->event);
-/* FIXME: skip data for now */
+	LogBuffer_t *log = GetLogBuffer (&info, i);
+	if (log->vpId >= Hdr->nVProcs) {
+	    fprintf(stderr, "bogus vproc ID %d in buffer %d\n", log->vpId, i);
+	    exit (1);
 	}
+	int n = NumBufEvents (log);
+	info.bufStart[i] = VPEvents[log->vpId].nEvents;
+	VPEvents[log->vpId].nEvents += n;
+	NumEvents += n;
     }
+    if (NumEvents == 0) {
+	fprintf(stderr, "no events in file\n");
+	exit (1);
+    }
+    for (int vp = 0;  vp < Hdr->nVProcs;  vp++)
+	VPEvents[vp].events = new Event[VPEvents[vp].nEvents];
+
+  /* read in the events */
+    ParallelFor ((numBufs + BUFS_PER_TASK - 1) / BUFS_PER_TASK, DecodeBuffers, &info);
 
   /* sort the events by timestamp */
-    qsort (Events, NumEvents, sizeof(Event), CompareEvent);
+    ParallelFor (Hdr->nVProcs, SortVProcEvents, 0);
 
   /* Adjust the timestamps to be relative to the start of the run */
     uint64_t startTime = GetTimestamp (&(Hdr->startTime));
-    if (Events[0].timestamp < startTime) {
-	fprintf (stdout, "** Warning: first event occurs %lld ns. before start\n",
-	    startTime - Events[0].timestamp);
-	startTime = Events[0].timestamp;
+    uint64_t firstTime = UINT64_MAX;
+    for (int vp = 0;  vp < Hdr->nVProcs;  vp++) {
+	if (VPEvents[vp].nEvents > 0)
+	    firstTime = (VPEvents[vp].events[0].timestamp < firstTime)
+		? VPEvents[vp].events[0].timestamp
+		: firstTime;
     }
-    for (int i = 0;  i < NumEvents;  i++) {
-	Events[i].timestamp -= startTime;
+    if (firstTime < startTime) {
+	fprintf (stdout, "** Warning: first event occurs %lld ns. before start\n",
+	    (long long)(startTime - firstTime));
+	startTime = firstTime;
     }
+    info.startTime = startTime;
+    ParallelFor (Hdr->nVProcs, AdjustVProcEvents, &info);
 
-    fclose (f);
-    delete buf;
+    munmap (base, fileSize);
+    delete[] info.bufStart;
 
 }
 
@@ -596,7 +810,6 @@ static void PrintTimestamp (FILE *out, uint64_t timestamp)
 
 static void Usage (int sts)
 {
-    fprintf (stderr, "usage: log-work-stealing [-o outfile] [-log logfile]\n");
+    fprintf (stderr, "usage: log-work-stealing [-o outfile] [-log logfile] [-j nthreads]\n");
     exit (sts);
 }
-
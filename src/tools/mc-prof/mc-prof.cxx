@@ -0,0 +1,289 @@
+/* mc-prof.cxx
+ *
+ * COPYRIGHT (c) 2009 The Manticore Project (http://manticore.cs.uchicago.edu)
+ * All rights reserved.
+ *
+ * Reports the samples collected by the runtime's sampling profiler (see
+ * src/lib/parallel-rt/misc/profile.c).  Each sampled program counter is attributed
+ * to the function with the greatest address that is not above it.  The function
+ * table in the profile only covers Manticore code; the symbols of the runtime system
+ * can be added by passing the output of "nm -n" on the executable with the "-nm"
+ * option.
+ *
+ * By default, the program prints a flat profile.  With the "-folded" option, it
+ * prints the samples in the "folded stack" format that is read by flame-graph tools.
+ * Since Manticore code is in CPS and does not have a call stack, each stack consists
+ * of the vproc, the "atomic" frame for samples taken while signals were masked, and
+ * the function.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+
+#define DFLT_PROF_FILE	"prof.out"
+
+struct Func {
+    uint64_t	addr;
+    std::string	name;
+
+    bool operator< (Func const &f) const { return (addr < f.addr); }
+};
+
+struct Sample {
+    int		vpId;
+    uint64_t	pc;
+    bool	atomic;
+    unsigned	count;
+};
+
+struct FuncInfo {
+    std::string	name;
+    uint64_t	samples;	// total number of samples
+    uint64_t	atomic;		// number of samples taken while atomic
+
+    static bool Cmp (FuncInfo const *a, FuncInfo const *b)
+    {
+	if (a->samples != b->samples) return (a->samples > b->samples);
+	else return (a->name < b->name);
+    }
+};
+
+static std::vector<Func>	Funcs;
+static std::vector<Sample>	Samples;
+static int			Rate = 0;
+static int			NumVProcs = 0;
+static uint64_t			NumDropped = 0;
+
+static void LoadProfile (const char *file);
+static void LoadSymbols (const char *file);
+static const char *FuncName (uint64_t pc);
+static void Usage (int sts);
+
+int main (int argc, const char **argv)
+{
+    const char *profFile = DFLT_PROF_FILE;
+    const char *nmFile = 0;
+    bool folded = false;
+    FILE *out = stdout;
+
+  // process args
+    int i = 1;
+    while (i < argc) {
+	if (strcmp(argv[i], "-h") == 0) {
+	    Usage (0);
+	}
+	else if (strcmp(argv[i], "-folded") == 0) {
+	    folded = true; i++;
+	}
+	else if (strcmp(argv[i], "-o") == 0) {
+	    if (++i < argc) {
+		out = fopen(argv[i], "w"); i++;
+		if (out == NULL) {
+		    perror("fopen");
+		    exit(1);
+		}
+	    }
+	    else {
+		fprintf(stderr, "missing filename for \"-o\" option\n");
+		Usage (1);
+	    }
+	}
+	else if (strcmp(argv[i], "-nm") == 0) {
+	    if (++i < argc) {
+		nmFile = argv[i]; i++;
+	    }
+	    else {
+		fprintf(stderr, "missing filename for \"-nm\" option\n");
+		Usage (1);
+	    }
+	}
+	else if (argv[i][0] == '-') {
+	    fprintf(stderr, "invalid argument \"%s\"\n", argv[i]);
+	    Usage(1);
+	}
+	else
+	    break;
+    }
+    if (i < argc) {
+	profFile = argv[i++];
+	if (i < argc)
+	    Usage (1);
+    }
+
+    LoadProfile (profFile);
+    if (nmFile != 0)
+	LoadSymbols (nmFile);
+    std::sort (Funcs.begin(), Funcs.end());
+
+    if (folded) {
+      // aggregate the samples by vproc, atomic flag, and function
+	std::map<std::string, uint64_t> stacks;
+	for (size_t j = 0;  j < Samples.size();  j++) {
+	    char prefix[64];
+	    snprintf (prefix, sizeof(prefix), "vproc %d;%s",
+		Samples[j].vpId, Samples[j].atomic ? "atomic;" : "");
+	    stacks[std::string(prefix) + FuncName(Samples[j].pc)] += Samples[j].count;
+	}
+	for (std::map<std::string, uint64_t>::iterator it = stacks.begin();  it != stacks.end();  it++)
+	    fprintf (out, "%s %" PRIu64 "\n", it->first.c_str(), it->second);
+    }
+    else {
+      // aggregate the samples by function
+	std::map<std::string, FuncInfo> funcs;
+	uint64_t total = 0;
+	for (size_t j = 0;  j < Samples.size();  j++) {
+	    const char *name = FuncName(Samples[j].pc);
+	    FuncInfo &info = funcs[name];
+	    info.name = name;
+	    info.samples += Samples[j].count;
+	    if (Samples[j].atomic)
+		info.atomic += Samples[j].count;
+	    total += Samples[j].count;
+	}
+	std::vector<FuncInfo *> sorted;
+	for (std::map<std::string, FuncInfo>::iterator it = funcs.begin();  it != funcs.end();  it++)
+	    sorted.push_back (&(it->second));
+	std::sort (sorted.begin(), sorted.end(), FuncInfo::Cmp);
+
+	fprintf (out, "%" PRIu64 " samples at %d Hz from %d vprocs", total, Rate, NumVProcs);
+	if (NumDropped > 0)
+	    fprintf (out, " (%" PRIu64 " dropped)", NumDropped);
+	fprintf (out, "\n\n");
+	fprintf (out, "%8s %10s %10s %8s  %s\n", "%time", "seconds", "samples", "atomic", "function");
+	for (size_t j = 0;  j < sorted.size();  j++) {
+	    FuncInfo *info = sorted[j];
+	    fprintf (out, "%7.2f%% %10.3f %10" PRIu64 " %8" PRIu64 "  %s\n",
+		100.0 * (double)info->samples / (double)total,
+		(Rate > 0) ? (double)info->samples / (double)Rate : 0.0,
+		info->samples, info->atomic, info->name.c_str());
+	}
+    }
+
+    if (out != stdout)
+	fclose (out);
+
+    return 0;
+
+}
+
+/* LoadProfile:
+ *
+ * Load the function table and samples from a profile file.
+ */
+static void LoadProfile (const char *file)
+{
+    FILE *f = fopen(file, "r");
+    if (f == NULL) {
+	fprintf(stderr, "unable to open \"%s\"\n", file);
+	exit (1);
+    }
+
+    char line[1024];
+    int version;
+    if ((fgets(line, sizeof(line), f) == NULL)
+    || (sscanf(line, "manticore-profile %d", &version) != 1)) {
+	fprintf(stderr, "\"%s\" is not a profile file\n", file);
+	exit (1);
+    }
+    else if (version != 1) {
+	fprintf(stderr, "\"%s\" has unknown version %d\n", file, version);
+	exit (1);
+    }
+
+    int lnum = 1;
+    while (fgets(line, sizeof(line), f) != NULL) {
+	char name[1024];
+	unsigned long long addr;
+	int vpId, atomic;
+	unsigned count;
+	lnum++;
+	if (sscanf(line, "func %llx %1023s", &addr, name) == 2) {
+	    Func fn;
+	    fn.addr = addr;
+	    fn.name = name;
+	    Funcs.push_back (fn);
+	}
+	else if (sscanf(line, "sample %d %llx %d %u", &vpId, &addr, &atomic, &count) == 4) {
+	    Sample s;
+	    s.vpId = vpId;
+	    s.pc = addr;
+	    s.atomic = (atomic != 0);
+	    s.count = count;
+	    Samples.push_back (s);
+	}
+	else if (sscanf(line, "dropped %d %u", &vpId, &count) == 2) {
+	    NumDropped += count;
+	}
+	else if (sscanf(line, "rate %d", &Rate) == 1) {
+	}
+	else if (sscanf(line, "nvprocs %d", &NumVProcs) == 1) {
+	}
+	else {
+	    fprintf(stderr, "%s:%d: bogus line\n", file, lnum);
+	    exit (1);
+	}
+    }
+
+    fclose (f);
+
+}
+
+/* LoadSymbols:
+ *
+ * Add the text symbols from the output of "nm" to the function table.
+ */
+static void LoadSymbols (const char *file)
+{
+    FILE *f = fopen(file, "r");
+    if (f == NULL) {
+	fprintf(stderr, "unable to open \"%s\"\n", file);
+	exit (1);
+    }
+
+    char line[1024];
+    while (fgets(line, sizeof(line), f) != NULL) {
+	char name[1024];
+	unsigned long long addr;
+	char kind;
+	if ((sscanf(line, "%llx %c %1023s", &addr, &kind, name) == 3)
+	&& ((kind == 'T') || (kind == 't'))) {
+	    Func fn;
+	    fn.addr = addr;
+	    fn.name = name;
+	    Funcs.push_back (fn);
+	}
+    }
+
+    fclose (f);
+
+}
+
+/* FuncName:
+ *
+ * Return the name of the function that contains the given address; Funcs must
+ * be sorted.
+ */
+static const char *FuncName (uint64_t pc)
+{
+    Func key;
+    key.addr = pc;
+    std::vector<Func>::iterator it = std::upper_bound (Funcs.begin(), Funcs.end(), key);
+    if (it == Funcs.begin())
+	return "<unknown>";
+    else
+	return (--it)->name.c_str();
+
+}
+
+static void Usage (int sts)
+{
+    fprintf (stderr, "usage: mc-prof [-folded] [-o outfile] [-nm symfile] [proffile]\n");
+    exit (sts);
+}